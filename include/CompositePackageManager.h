@@ -0,0 +1,32 @@
+#pragma once
+
+#include "PackageManager.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pkg {
+
+class CompositePackageManager : public PackageManager {
+public:
+  static std::unique_ptr<CompositePackageManager> detect();
+
+  void addBackend(std::string source, std::unique_ptr<PackageManager> backend);
+  bool empty() const { return backends_.empty(); }
+
+  std::vector<Package> listInstalled() override;
+  bool fillDetails(Package &pkg) override;
+  bool listFiles(const Package &pkg, std::vector<FileEntry> &out) override;
+  void visitInstalled(FieldMask fields, const PackageVisitor &visit,
+                      std::pmr::memory_resource *scratch) override;
+
+private:
+  struct Backend {
+    std::string source;
+    std::unique_ptr<PackageManager> manager;
+  };
+
+  std::vector<Backend> backends_;
+};
+
+} // namespace pkg
\ No newline at end of file
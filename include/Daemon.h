@@ -0,0 +1,28 @@
+#pragma once
+
+#include "PackageManager.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pkg {
+
+int run_daemon(std::shared_ptr<PackageManager> manager,
+               const std::string &socket_path,
+               const std::vector<std::string> &watch_paths);
+
+struct BenchResult {
+  std::size_t requests = 0;
+  std::size_t failures = 0;
+  double seconds = 0.0;
+  double p50_us = 0.0;
+  double p99_us = 0.0;
+  double max_us = 0.0;
+};
+
+BenchResult benchmark_daemon(const std::string &socket_path, unsigned clients,
+                             std::size_t requests_per_client);
+
+} // namespace pkg
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "PackageManager.h"
+#include "StringMap.h"
+
+#include <string_view>
+#include <vector>
+
+namespace pkg {
+
+struct ResolvedDep {
+  int target = -1;
+  bool satisfied = false;
+};
+
+struct BrokenDep {
+  int package;
+  int dep;
+};
+
+class DependencyIndex {
+public:
+  struct Provider {
+    int package;
+    int provide;
+  };
+
+  void build(const std::vector<Package> &packages);
+  void update(const std::vector<Package> &packages, int index);
+
+  bool empty() const { return edges_.empty(); }
+  std::size_t size() const { return edges_.size(); }
+
+  const std::vector<ResolvedDep> &depends(int index) const {
+    return edges_[index];
+  }
+  const std::vector<Provider> &providers(std::string_view name) const;
+  bool has_broken(int index) const { return broken_[index] != 0; }
+  std::vector<BrokenDep> broken() const;
+  void link_required_by(std::vector<Package> &packages) const;
+
+private:
+  ResolvedDep resolve(const std::vector<Package> &packages, int from,
+                      std::string_view dep) const;
+
+  StringMap<std::vector<Provider>> providers_;
+  std::vector<std::vector<ResolvedDep>> edges_;
+  std::vector<char> broken_;
+};
+
+} // namespace pkg
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "DependencyIndex.h"
+#include "PackageManager.h"
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+namespace pkg {
+
+class DependencyTree {
+public:
+  enum class Direction : std::uint8_t { Depends, RequiredBy };
+
+  struct Row {
+    int package = -1;
+    int parent = -1;
+    int edge = -1;
+    std::uint16_t depth = 0;
+    Direction direction = Direction::Depends;
+    bool header = false;
+    bool expanded = false;
+    bool seen = false;
+    bool leaf = true;
+  };
+
+  void reset(int root, const std::vector<Package> &packages,
+             const DependencyIndex &deps);
+
+  int root() const { return root_; }
+  const std::vector<Row> &rows() const { return rows_; }
+  int cursor() const { return cursor_; }
+
+  void move(int delta);
+  bool expand(const std::vector<Package> &packages,
+              const DependencyIndex &deps, std::vector<int> &revealed);
+  void collapse();
+
+private:
+  static long key(int package, Direction direction) {
+    return static_cast<long>(package) * 2 +
+           (direction == Direction::RequiredBy ? 1 : 0);
+  }
+
+  void children(const std::vector<Package> &packages,
+                const DependencyIndex &deps, const Row &parent,
+                std::vector<Row> &out) const;
+  bool has_children(const std::vector<Package> &packages,
+                    const DependencyIndex &deps, int package,
+                    Direction direction) const;
+  int resolve_dependent(const std::vector<Package> &packages,
+                        const DependencyIndex &deps, int package,
+                        int edge) const;
+
+  int root_ = -1;
+  int cursor_ = 0;
+  std::vector<Row> rows_;
+  std::unordered_set<long> expanded_;
+};
+
+} // namespace pkg
\ No newline at end of file
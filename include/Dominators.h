@@ -0,0 +1,55 @@
+#pragma once
+
+#include "DependencyIndex.h"
+#include "PackageManager.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pkg {
+
+struct Footprint {
+  std::size_t count = 0;
+  std::uint64_t size = 0;
+};
+
+class DominatorTree {
+public:
+  void build(const std::vector<Package> &packages,
+             const DependencyIndex &deps);
+  void update(const std::vector<Package> &packages,
+              const DependencyIndex &deps, int changed);
+
+  bool empty() const { return footprint_.empty(); }
+  std::size_t size() const { return explicit_.size(); }
+
+  int idom(int index) const {
+    return idom_[index] == root() ? -1 : idom_[index];
+  }
+  const Footprint &exclusive(int index) const { return footprint_[index]; }
+  std::uint64_t revision() const { return revision_; }
+
+private:
+  int root() const { return static_cast<int>(explicit_.size()); }
+
+  void set_successors(const DependencyIndex &deps, int index);
+  bool same_successors(const DependencyIndex &deps, int index) const;
+  void link(int from, int to);
+  void number();
+  int intersect(int a, int b) const;
+  void solve(const std::vector<int> &nodes);
+  void accumulate(const std::vector<Package> &packages);
+
+  std::vector<std::vector<int>> succ_;
+  std::vector<std::vector<int>> pred_;
+  std::vector<char> explicit_;
+  std::vector<std::uint64_t> sizes_;
+  std::vector<int> idom_;
+  std::vector<int> post_;
+  std::vector<int> rpo_;
+  std::vector<Footprint> footprint_;
+  std::uint64_t revision_ = 0;
+};
+
+} // namespace pkg
\ No newline at end of file
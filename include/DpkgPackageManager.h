@@ -0,0 +1,25 @@
+#pragma once
+
+#include "PackageManager.h"
+#include <string>
+#include <vector>
+
+namespace pkg {
+
+class DpkgPackageManager : public PackageManager {
+public:
+  explicit DpkgPackageManager(
+      std::string status_path = "/var/lib/dpkg/status",
+      std::string extended_states_path = "/var/lib/apt/extended_states");
+
+  bool fillDetails(Package &pkg) override;
+  bool listFiles(const Package &pkg, std::vector<FileEntry> &out) override;
+  void visitInstalled(FieldMask fields, const PackageVisitor &visit,
+                      std::pmr::memory_resource *scratch) override;
+
+private:
+  std::string status_path_;
+  std::string extended_states_path_;
+};
+
+} // namespace pkg
\ No newline at end of file
@@ -7,8 +7,14 @@ namespace pkg {
 
 class DummyPackageManager : public PackageManager {
 public:
-  std::vector<Package> listInstalled() override;
+  explicit DummyPackageManager(int count = 50) : count_(count) {}
+
   bool fillDetails(Package &pkg) override;
+  void visitInstalled(FieldMask fields, const PackageVisitor &visit,
+                      std::pmr::memory_resource *scratch) override;
+
+private:
+  int count_;
 };
 
 } // namespace pkg
\ No newline at end of file
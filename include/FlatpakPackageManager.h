@@ -0,0 +1,19 @@
+#pragma once
+
+#include "PackageManager.h"
+#include <vector>
+
+namespace pkg {
+
+class FlatpakPackageManager : public PackageManager {
+public:
+  std::vector<Package> listInstalled() override;
+  bool fillDetails(Package &pkg) override;
+  void visitInstalled(FieldMask fields, const PackageVisitor &visit,
+                      std::pmr::memory_resource *scratch) override;
+
+private:
+  std::vector<Package> listPackages(FieldMask fields);
+};
+
+} // namespace pkg
\ No newline at end of file
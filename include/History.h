@@ -0,0 +1,58 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "StringMap.h"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pkg {
+
+enum class HistoryAction : std::uint8_t {
+  Installed,
+  Upgraded,
+  Downgraded,
+  Reinstalled,
+  Removed
+};
+
+std::string_view action_label(HistoryAction action);
+
+struct HistoryEvent {
+  std::int64_t time = 0;
+  HistoryAction action = HistoryAction::Installed;
+  std::string_view package;
+  std::string_view source;
+  std::string_view old_version;
+  std::string_view new_version;
+};
+
+bool parse_time_spec(std::string_view spec, std::int64_t now,
+                     std::int64_t &out);
+std::string format_timestamp(std::int64_t time);
+
+class History {
+public:
+  bool load(const std::string &path, unsigned threads = 0);
+
+  bool empty() const { return events_.empty(); }
+  std::span<const HistoryEvent> events() const { return events_; }
+  std::span<const HistoryEvent> since(std::int64_t time) const;
+
+  std::vector<const HistoryEvent *> for_package(std::string_view name,
+                                                std::string_view source) const;
+  bool changed_since(std::string_view name, std::string_view source,
+                     std::int64_t time) const;
+
+private:
+  void rebuild_index();
+
+  std::vector<MappedFile> files_;
+  std::vector<HistoryEvent> events_;
+  StringMap<std::vector<std::uint32_t>> by_package_;
+};
+
+} // namespace pkg
\ No newline at end of file
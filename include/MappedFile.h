@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace pkg {
+
+class MappedFile {
+public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  bool ok() const { return ok_; }
+  std::string_view view() const {
+    return {static_cast<const char *>(data_), size_};
+  }
+
+private:
+  void reset();
+
+  void *data_ = nullptr;
+  std::size_t size_ = 0;
+  bool ok_ = false;
+};
+
+} // namespace pkg
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+namespace pkg {
+
+enum class MemTag : std::uint8_t {
+  Other,
+  Backend,
+  Packages,
+  Index,
+  History,
+  Search,
+  Render
+};
+
+constexpr std::size_t mem_tag_count = 7;
+
+std::string_view mem_tag_label(MemTag tag);
+
+void mem_stats_enable();
+bool mem_stats_enabled();
+
+class MemScope {
+public:
+  explicit MemScope(MemTag tag);
+  ~MemScope();
+
+  MemScope(const MemScope &) = delete;
+  MemScope &operator=(const MemScope &) = delete;
+
+private:
+  MemTag previous_;
+};
+
+struct MemTagStats {
+  std::uint64_t live_bytes = 0;
+  std::uint64_t live_blocks = 0;
+  std::uint64_t allocations = 0;
+};
+
+struct MemReport {
+  std::array<MemTagStats, mem_tag_count> tags{};
+  std::uint64_t tracked_bytes = 0;
+  std::uint64_t malloc_in_use = 0;
+  std::uint64_t untracked_bytes = 0;
+  std::uint64_t rss_bytes = 0;
+};
+
+MemReport mem_report();
+std::uint64_t mem_allocations();
+
+class KeystrokeAllocations {
+public:
+  void begin();
+  void end();
+
+  std::size_t keys() const { return keys_; }
+  std::uint64_t total() const;
+  std::uint64_t by_tag(MemTag tag) const {
+    return sums_[static_cast<std::size_t>(tag)];
+  }
+
+private:
+  std::array<std::uint64_t, mem_tag_count> start_{};
+  std::array<std::uint64_t, mem_tag_count> sums_{};
+  std::size_t keys_ = 0;
+  bool open_ = false;
+};
+
+void write_mem_json(std::FILE *out, const MemReport &report,
+                    const KeystrokeAllocations &keys);
+
+} // namespace pkg
\ No newline at end of file
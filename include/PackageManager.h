@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace pkg {
@@ -12,20 +17,92 @@ struct Package {
   std::string repo;
   std::string architecture;
   std::string install_date;
+  std::string source;
+  std::uint64_t installed_size = 0;
 
   std::vector<std::string> depends_on;
   std::vector<std::string> required_by;
+  std::vector<std::string> provides;
+  std::vector<std::string> conflicts;
+  std::vector<std::string> replaces;
 
   bool is_foreign = false;
   bool is_explicit = false;
 };
 
+using FieldMask = std::uint32_t;
+
+namespace field {
+constexpr FieldMask Name = 1u << 0;
+constexpr FieldMask Version = 1u << 1;
+constexpr FieldMask Description = 1u << 2;
+constexpr FieldMask Repo = 1u << 3;
+constexpr FieldMask Architecture = 1u << 4;
+constexpr FieldMask InstallDate = 1u << 5;
+constexpr FieldMask DependsOn = 1u << 6;
+constexpr FieldMask RequiredBy = 1u << 7;
+constexpr FieldMask Foreign = 1u << 8;
+constexpr FieldMask Explicit = 1u << 9;
+constexpr FieldMask Provides = 1u << 10;
+constexpr FieldMask Conflicts = 1u << 11;
+constexpr FieldMask Replaces = 1u << 12;
+constexpr FieldMask InstalledSize = 1u << 13;
+constexpr FieldMask All = ~0u;
+} // namespace field
+
+struct PackageRecord {
+  std::string_view name;
+  std::string_view version;
+  std::string_view description;
+  std::string_view repo;
+  std::string_view architecture;
+  std::string_view install_date;
+  std::string_view source;
+  std::uint64_t installed_size = 0;
+
+  std::span<const std::string_view> depends_on;
+  std::span<const std::string_view> required_by;
+  std::span<const std::string_view> provides;
+  std::span<const std::string_view> conflicts;
+  std::span<const std::string_view> replaces;
+
+  bool is_foreign = false;
+  bool is_explicit = false;
+};
+
+using PackageVisitor = std::function<void(const PackageRecord &)>;
+
+struct FileEntry {
+  enum class Type : std::uint8_t { File, Directory, Symlink };
+
+  std::string path;
+  Type type = Type::File;
+  int mode = -1;
+  std::int64_t size = -1;
+  std::string sha256;
+  std::string md5;
+  std::string link;
+  bool backup = false;
+};
+
+Package to_package(const PackageRecord &record);
+void visit_packages(const std::vector<Package> &packages, FieldMask fields,
+                    const PackageVisitor &visit,
+                    std::pmr::memory_resource *scratch);
+void link_required_by(std::vector<Package> &packages);
+
 class PackageManager {
 public:
   virtual ~PackageManager() = default;
 
-  virtual std::vector<Package> listInstalled() = 0;
+  virtual std::vector<Package> listInstalled();
   virtual bool fillDetails(Package &pkg) = 0;
+  virtual bool listFiles(const Package &pkg, std::vector<FileEntry> &out);
+
+  virtual void
+  visitInstalled(FieldMask fields, const PackageVisitor &visit,
+                 std::pmr::memory_resource *scratch =
+                     std::pmr::get_default_resource()) = 0;
 };
 
 } // namespace pkg
\ No newline at end of file
@@ -1,14 +1,22 @@
 #pragma once
 
 #include "PackageManager.h"
+#include <string>
 #include <vector>
 
 namespace pkg {
 
 class PacmanPackageManager : public PackageManager {
 public:
-  std::vector<Package> listInstalled() override;
+  explicit PacmanPackageManager(std::string db_path = "/var/lib/pacman");
+
   bool fillDetails(Package &pkg) override;
+  bool listFiles(const Package &pkg, std::vector<FileEntry> &out) override;
+  void visitInstalled(FieldMask fields, const PackageVisitor &visit,
+                      std::pmr::memory_resource *scratch) override;
+
+private:
+  std::string db_path_;
 };
 
 } // namespace pkg
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "PackageManager.h"
+#include <string>
+#include <vector>
+
+namespace pkg {
+
+class PipPackageManager : public PackageManager {
+public:
+  explicit PipPackageManager(std::string pip = "pip3");
+
+  std::vector<Package> listInstalled() override;
+  bool fillDetails(Package &pkg) override;
+  void visitInstalled(FieldMask fields, const PackageVisitor &visit,
+                      std::pmr::memory_resource *scratch) override;
+
+private:
+  std::vector<Package> listPackages(FieldMask fields);
+
+  std::string pip_;
+};
+
+} // namespace pkg
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "PackageManager.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pkg {
+
+namespace proto {
+
+constexpr std::uint32_t max_frame_size = 64u << 20;
+
+enum class Op : std::uint8_t {
+  List = 1,
+  Filter = 2,
+  Search = 3,
+  Details = 4,
+  Packages = 0x80,
+  Error = 0x81
+};
+
+enum class FilterKind : std::uint8_t { Explicit = 1, Foreign = 2, Broken = 3 };
+
+class Writer {
+public:
+  explicit Writer(std::string &out) : out_(out) {}
+
+  void u8(std::uint8_t v) { out_.push_back(static_cast<char>(v)); }
+  void varint(std::uint64_t v);
+  void str(std::string_view s);
+
+private:
+  std::string &out_;
+};
+
+class Reader {
+public:
+  explicit Reader(std::string_view in) : in_(in) {}
+
+  bool ok() const { return ok_; }
+  bool done() const { return in_.empty(); }
+
+  std::uint8_t u8();
+  std::uint64_t varint();
+  std::string_view str();
+
+private:
+  std::string_view in_;
+  bool ok_ = true;
+};
+
+enum class FrameStatus { Incomplete, Ready, Invalid };
+
+std::size_t begin_frame(std::string &out, Op op);
+void end_frame(std::string &out, std::size_t start);
+FrameStatus next_frame(std::string_view buffer, Op &op,
+                       std::string_view &payload, std::size_t &consumed);
+
+struct RecordLists {
+  explicit RecordLists(std::pmr::memory_resource *resource)
+      : depends_on(resource), required_by(resource), provides(resource),
+        conflicts(resource), replaces(resource) {}
+
+  std::pmr::vector<std::string_view> depends_on;
+  std::pmr::vector<std::string_view> required_by;
+  std::pmr::vector<std::string_view> provides;
+  std::pmr::vector<std::string_view> conflicts;
+  std::pmr::vector<std::string_view> replaces;
+};
+
+void encode_package(Writer &w, const Package &pkg, FieldMask fields);
+bool decode_package(Reader &r, FieldMask fields, PackageRecord &record,
+                    RecordLists &lists);
+
+std::string default_socket_path();
+
+class Connection {
+public:
+  Connection() = default;
+  ~Connection();
+
+  Connection(const Connection &) = delete;
+  Connection &operator=(const Connection &) = delete;
+
+  bool open(const std::string &path);
+  bool call(Op op, std::string_view payload, Op &reply,
+            std::string &reply_payload);
+
+private:
+  int fd_ = -1;
+  std::string buffer_;
+};
+
+} // namespace proto
+
+} // namespace pkg
\ No newline at end of file
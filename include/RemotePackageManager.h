@@ -0,0 +1,33 @@
+#pragma once
+
+#include "PackageManager.h"
+#include "Protocol.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace pkg {
+
+class RemotePackageManager : public PackageManager {
+public:
+  explicit RemotePackageManager(std::string socket_path);
+
+  bool connect();
+
+  bool fillDetails(Package &pkg) override;
+  void visitInstalled(FieldMask fields, const PackageVisitor &visit,
+                      std::pmr::memory_resource *scratch) override;
+
+private:
+  bool open_locked();
+  bool call(proto::Op op, std::string_view payload, proto::Op &reply,
+            std::string &reply_payload);
+
+  std::string socket_path_;
+  std::mutex mutex_;
+  std::unique_ptr<proto::Connection> connection_;
+};
+
+} // namespace pkg
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pkg {
+
+class KeySource {
+public:
+  virtual ~KeySource() = default;
+
+  virtual int next(int timeout_ms) = 0;
+};
+
+class TerminalKeys : public KeySource {
+public:
+  int next(int timeout_ms) override;
+};
+
+struct ReplayReport {
+  std::size_t keys = 0;
+  double p50_ms = 0.0;
+  double p99_ms = 0.0;
+  double max_ms = 0.0;
+  std::uint64_t bytes = 0;
+  std::uint64_t allocations = 0;
+  bool stalled = false;
+};
+
+class ScreenSink {
+public:
+  ScreenSink();
+  ~ScreenSink();
+
+  ScreenSink(const ScreenSink &) = delete;
+  ScreenSink &operator=(const ScreenSink &) = delete;
+
+  bool ok() const { return stream_ != nullptr; }
+  std::FILE *stream() const { return stream_; }
+  std::uint64_t drain();
+
+private:
+  std::FILE *stream_ = nullptr;
+};
+
+class ScriptKeys : public KeySource {
+public:
+  ScriptKeys(std::vector<int> keys, ScreenSink &screen)
+      : keys_(std::move(keys)), screen_(screen) {}
+
+  int next(int timeout_ms) override;
+  ReplayReport report() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  std::vector<int> keys_;
+  std::size_t pos_ = 0;
+  ScreenSink &screen_;
+  std::uint64_t bytes_ = 0;
+  std::uint64_t allocations_ = 0;
+  std::uint64_t allocations_at_send_ = 0;
+
+  bool pending_ = false;
+  bool stalled_ = false;
+  int polls_ = 0;
+  Clock::time_point sent_;
+  std::vector<double> latencies_ms_;
+};
+
+bool parse_script(std::string_view text, std::vector<int> &keys);
+bool load_script(const std::string &name_or_path, std::vector<int> &keys);
+std::vector<std::string_view> builtin_scripts();
+
+} // namespace pkg
\ No newline at end of file
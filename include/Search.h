@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string_view>
+
+namespace pkg {
+
+bool fuzzy_match(std::string_view pattern, std::string_view text);
+
+} // namespace pkg
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "PackageManager.h"
+#include "Version.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pkg {
+
+namespace snapshot_flag {
+constexpr std::uint8_t Explicit = 1u << 0;
+constexpr std::uint8_t Foreign = 1u << 1;
+} // namespace snapshot_flag
+
+bool write_snapshot(const std::string &path,
+                    const std::vector<Package> &packages,
+                    const std::string &host);
+
+class Snapshot {
+public:
+  explicit Snapshot(const std::string &path);
+
+  bool ok() const { return ok_; }
+  std::string_view host() const { return host_; }
+  std::size_t size() const { return count_; }
+
+  std::string_view name(std::size_t i) const;
+  std::string_view version(std::size_t i) const;
+  std::string_view source(std::size_t i) const;
+  std::string_view architecture(std::size_t i) const;
+  std::uint8_t flags(std::size_t i) const { return flags_[i]; }
+
+  std::size_t find(std::string_view name) const;
+
+private:
+  struct Column {
+    const std::uint32_t *offsets = nullptr;
+    const char *data = nullptr;
+
+    std::string_view at(std::size_t i) const {
+      return {data + offsets[i], offsets[i + 1] - offsets[i]};
+    }
+  };
+
+  MappedFile file_;
+  bool ok_ = false;
+  std::size_t count_ = 0;
+  std::string_view host_;
+  Column names_;
+  Column versions_;
+  Column sources_;
+  Column architectures_;
+  const std::uint8_t *flags_ = nullptr;
+};
+
+struct SnapshotDiff {
+  enum class Kind { Added, Removed, Changed };
+
+  Kind kind;
+  std::string_view name;
+  std::string_view source;
+  std::string_view architecture;
+  std::string_view old_version;
+  std::string_view new_version;
+};
+
+std::vector<SnapshotDiff> diff_snapshots(const Snapshot &from,
+                                         const Snapshot &to);
+
+struct VersionHistogram {
+  std::string name;
+  std::vector<std::pair<std::string, std::uint32_t>> versions;
+};
+
+std::vector<VersionHistogram>
+aggregate_versions(const std::vector<std::string> &paths, unsigned threads);
+
+std::vector<std::pair<std::string, std::string>>
+hosts_matching(const std::vector<std::string> &paths,
+               const Constraint &constraint, unsigned threads);
+
+} // namespace pkg
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct z_stream_s;
+
+namespace pkg {
+
+struct TextStoreStats {
+  std::size_t entries = 0;
+  std::size_t blocks = 0;
+  std::uint64_t raw_bytes = 0;
+  std::uint64_t compressed_bytes = 0;
+  std::uint64_t dictionary_bytes = 0;
+  std::uint64_t index_bytes = 0;
+  std::uint64_t cache_bytes = 0;
+  std::uint64_t cache_hits = 0;
+  std::uint64_t cache_misses = 0;
+
+  std::uint64_t footprint() const {
+    return compressed_bytes + dictionary_bytes + index_bytes + cache_bytes;
+  }
+};
+
+class TextStore {
+public:
+  explicit TextStore(std::size_t block_entries = 32,
+                     std::size_t cache_blocks = 4);
+  ~TextStore();
+
+  TextStore(const TextStore &) = delete;
+  TextStore &operator=(const TextStore &) = delete;
+
+  bool build(const std::vector<std::string_view> &texts);
+  void clear();
+  void set_cache_blocks(std::size_t blocks);
+
+  std::size_t size() const { return entries_; }
+  bool empty() const { return entries_ == 0; }
+
+  bool get(std::size_t id, std::string &out);
+  bool set(std::size_t id, std::string_view text);
+  std::size_t search(std::string_view needle,
+                     std::vector<std::size_t> &matches);
+
+  TextStoreStats stats() const;
+
+private:
+  using Signature = std::array<std::uint64_t, 8>;
+
+  struct Block {
+    std::uint64_t offset = 0;
+    std::uint32_t compressed = 0;
+    std::uint32_t raw = 0;
+    Signature trigrams{};
+  };
+
+  struct CachedBlock {
+    std::size_t block = static_cast<std::size_t>(-1);
+    std::uint64_t used = 0;
+    std::string text;
+  };
+
+  bool decode(std::size_t block, std::string &out);
+  bool encode(std::string_view raw, std::string &out) const;
+  const std::string *cached(std::size_t block);
+  const std::string *peek(std::size_t block) const;
+  std::uint32_t entry_end(std::size_t id) const;
+
+  std::size_t block_entries_;
+  std::size_t entries_ = 0;
+  std::uint64_t raw_bytes_ = 0;
+  std::vector<Block> blocks_;
+  std::vector<std::uint32_t> offsets_;
+  std::string data_;
+  std::string dictionary_;
+  int window_bits_ = 15;
+  z_stream_s *inflater_ = nullptr;
+  std::uint64_t inflater_bytes_ = 0;
+
+  std::vector<CachedBlock> cache_;
+  std::string scratch_;
+  std::uint64_t tick_ = 0;
+  std::uint64_t hits_ = 0;
+  std::uint64_t misses_ = 0;
+};
+
+} // namespace pkg
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "PackageManager.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pkg {
+
+enum class VerifyProblem : std::uint8_t {
+  Missing,
+  Unreadable,
+  Type,
+  Mode,
+  Size,
+  Checksum,
+  Link
+};
+
+std::string_view problem_label(VerifyProblem problem);
+
+struct VerifyIssue {
+  std::string package;
+  std::string path;
+  VerifyProblem problem = VerifyProblem::Missing;
+  std::string detail;
+};
+
+struct VerifyProgress {
+  std::atomic<std::size_t> packages_total{0};
+  std::atomic<std::size_t> packages_done{0};
+  std::atomic<std::size_t> files_total{0};
+  std::atomic<std::size_t> files_done{0};
+  std::atomic<std::uint64_t> bytes_hashed{0};
+  std::atomic<std::size_t> issues{0};
+  std::atomic<bool> cancel{false};
+};
+
+using IssueSink = std::function<void(const VerifyIssue &)>;
+
+void verify_packages(PackageManager &manager,
+                     const std::vector<Package> &targets,
+                     const std::string &root, unsigned threads,
+                     VerifyProgress &progress, const IssueSink &sink);
+
+} // namespace pkg
\ No newline at end of file
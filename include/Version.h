@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string_view>
+
+namespace pkg {
+
+enum class VersionOp { Any, Less, LessEqual, Equal, GreaterEqual, Greater };
+
+enum class VersionScheme { Alpm, Debian };
+
+struct Constraint {
+  std::string_view name;
+  VersionOp op = VersionOp::Any;
+  std::string_view version;
+};
+
+int vercmp(std::string_view a, std::string_view b,
+           VersionScheme scheme = VersionScheme::Alpm);
+VersionScheme scheme_for_source(std::string_view source);
+
+Constraint parse_constraint(std::string_view text);
+bool satisfies(std::string_view version, VersionOp op, std::string_view wanted,
+               VersionScheme scheme = VersionScheme::Alpm);
+
+} // namespace pkg
\ No newline at end of file
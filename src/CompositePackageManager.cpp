@@ -0,0 +1,172 @@
+#include "CompositePackageManager.h"
+#include "DpkgPackageManager.h"
+#include "FlatpakPackageManager.h"
+#include "PacmanPackageManager.h"
+#include "PipPackageManager.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iterator>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace pkg {
+
+namespace {
+
+bool in_path(const std::string &exe) {
+  const char *env = std::getenv("PATH");
+  if (env == nullptr) {
+    return false;
+  }
+
+  std::string_view path(env);
+  while (!path.empty()) {
+    std::size_t colon = path.find(':');
+    std::string_view dir = path.substr(0, colon);
+    path = colon == std::string_view::npos ? std::string_view{}
+                                           : path.substr(colon + 1);
+    if (dir.empty()) {
+      continue;
+    }
+
+    std::string candidate = std::string(dir) + "/" + exe;
+    if (access(candidate.c_str(), X_OK) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace
+
+std::unique_ptr<CompositePackageManager> CompositePackageManager::detect() {
+  auto composite = std::make_unique<CompositePackageManager>();
+
+  if (in_path("pacman")) {
+    composite->addBackend("pacman", std::make_unique<PacmanPackageManager>());
+  }
+  if (access("/var/lib/dpkg/status", R_OK) == 0) {
+    composite->addBackend("dpkg", std::make_unique<DpkgPackageManager>());
+  }
+  if (in_path("flatpak")) {
+    composite->addBackend("flatpak", std::make_unique<FlatpakPackageManager>());
+  }
+  if (in_path("pip3")) {
+    composite->addBackend("pip", std::make_unique<PipPackageManager>("pip3"));
+  } else if (in_path("pip")) {
+    composite->addBackend("pip", std::make_unique<PipPackageManager>("pip"));
+  }
+
+  return composite;
+}
+
+void CompositePackageManager::addBackend(
+    std::string source, std::unique_ptr<PackageManager> backend) {
+  backends_.push_back(Backend{std::move(source), std::move(backend)});
+}
+
+void CompositePackageManager::visitInstalled(
+    FieldMask fields, const PackageVisitor &visit,
+    std::pmr::memory_resource *scratch) {
+  std::pmr::synchronized_pool_resource shared_scratch(scratch);
+  std::mutex visit_mutex;
+  std::vector<std::thread> threads;
+  threads.reserve(backends_.size());
+
+  for (auto &backend : backends_) {
+    threads.emplace_back([&, manager = backend.manager.get(),
+                          source = std::string_view(backend.source)] {
+      try {
+        manager->visitInstalled(
+            fields,
+            [&](const PackageRecord &record) {
+              PackageRecord tagged = record;
+              tagged.source = source;
+              std::lock_guard<std::mutex> lock(visit_mutex);
+              visit(tagged);
+            },
+            &shared_scratch);
+      } catch (const std::exception &) {
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+std::vector<Package> CompositePackageManager::listInstalled() {
+  std::vector<std::vector<Package>> parts(backends_.size());
+  std::vector<std::thread> threads;
+  threads.reserve(backends_.size());
+
+  for (std::size_t i = 0; i < backends_.size(); ++i) {
+    threads.emplace_back([this, &parts, i] {
+      try {
+        parts[i] = backends_[i].manager->listInstalled();
+        for (auto &pkg : parts[i]) {
+          pkg.source = backends_[i].source;
+        }
+      } catch (const std::exception &) {
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  if (parts.empty()) {
+    return {};
+  }
+
+  auto largest = std::max_element(
+      parts.begin(), parts.end(),
+      [](const auto &a, const auto &b) { return a.size() < b.size(); });
+  std::vector<Package> merged = std::move(*largest);
+
+  std::size_t total = merged.size();
+  for (const auto &part : parts) {
+    total += part.size();
+  }
+  merged.reserve(total);
+
+  for (auto &part : parts) {
+    merged.insert(merged.end(), std::make_move_iterator(part.begin()),
+                  std::make_move_iterator(part.end()));
+  }
+
+  return merged;
+}
+
+bool CompositePackageManager::fillDetails(Package &pkg) {
+  for (auto &backend : backends_) {
+    if (backend.source == pkg.source) {
+      return backend.manager->fillDetails(pkg);
+    }
+  }
+  return false;
+}
+
+bool CompositePackageManager::listFiles(const Package &pkg,
+                                        std::vector<FileEntry> &out) {
+  for (auto &backend : backends_) {
+    if (backend.source == pkg.source) {
+      return backend.manager->listFiles(pkg, out);
+    }
+  }
+  return false;
+}
+
+} // namespace pkg
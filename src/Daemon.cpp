@@ -0,0 +1,612 @@
+#include "Daemon.h"
+#include "DependencyIndex.h"
+#include "Protocol.h"
+#include "Search.h"
+#include "StringMap.h"
+
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace pkg {
+
+namespace {
+
+constexpr std::size_t max_pending_output = 4u << 20;
+constexpr long reload_delay_ms = 500;
+
+struct Index {
+  std::vector<Package> packages;
+  DependencyIndex deps;
+  StringMap<std::vector<std::uint32_t>> by_name;
+};
+
+struct Client {
+  std::string in;
+  std::string out;
+  std::size_t out_pos = 0;
+  bool writing = false;
+};
+
+std::shared_ptr<const Index> build_index(PackageManager &manager) {
+  auto index = std::make_shared<Index>();
+
+  std::pmr::unsynchronized_pool_resource scratch;
+  manager.visitInstalled(
+      field::All & ~field::RequiredBy,
+      [&](const PackageRecord &record) {
+        index->packages.push_back(to_package(record));
+      },
+      &scratch);
+
+  std::sort(index->packages.begin(), index->packages.end(),
+            [](const Package &a, const Package &b) {
+              return a.name != b.name ? a.name < b.name : a.source < b.source;
+            });
+  index->deps.build(index->packages);
+  index->deps.link_required_by(index->packages);
+
+  for (std::size_t i = 0; i < index->packages.size(); ++i) {
+    lookup_or_insert(index->by_name, index->packages[i].name)
+        .push_back(static_cast<std::uint32_t>(i));
+  }
+  return index;
+}
+
+bool filter_matches(const Index &index, std::size_t i,
+                    proto::FilterKind kind) {
+  const Package &pkg = index.packages[i];
+  switch (kind) {
+  case proto::FilterKind::Explicit:
+    return pkg.is_explicit;
+  case proto::FilterKind::Foreign:
+    return pkg.is_foreign;
+  case proto::FilterKind::Broken:
+    return index.deps.has_broken(static_cast<int>(i));
+  }
+  return false;
+}
+
+void write_error(std::string &out, std::string_view message) {
+  std::size_t start = proto::begin_frame(out, proto::Op::Error);
+  proto::Writer(out).str(message);
+  proto::end_frame(out, start);
+}
+
+void write_packages(std::string &out, const Index &index, FieldMask fields,
+                    const std::vector<std::uint32_t> &selected) {
+  std::size_t start = proto::begin_frame(out, proto::Op::Packages);
+  proto::Writer w(out);
+  w.varint(fields);
+  w.varint(selected.size());
+  for (std::uint32_t i : selected) {
+    proto::encode_package(w, index.packages[i], fields);
+  }
+  proto::end_frame(out, start);
+}
+
+void handle_request(const Index &index, proto::Op op, std::string_view payload,
+                    std::string &out) {
+  proto::Reader r(payload);
+  std::vector<std::uint32_t> selected;
+  auto fields = static_cast<FieldMask>(r.varint());
+
+  switch (op) {
+  case proto::Op::List:
+  case proto::Op::Filter:
+  case proto::Op::Search: {
+    auto kind = proto::FilterKind::Explicit;
+    std::string_view query;
+    if (op == proto::Op::Filter) {
+      kind = static_cast<proto::FilterKind>(r.u8());
+    } else if (op == proto::Op::Search) {
+      query = r.str();
+    }
+    if (!r.ok()) {
+      write_error(out, "malformed request");
+      return;
+    }
+
+    selected.reserve(op == proto::Op::List ? index.packages.size() : 0);
+    for (std::size_t i = 0; i < index.packages.size(); ++i) {
+      if ((op == proto::Op::Filter && !filter_matches(index, i, kind)) ||
+          (op == proto::Op::Search &&
+           !fuzzy_match(query, index.packages[i].name))) {
+        continue;
+      }
+      selected.push_back(static_cast<std::uint32_t>(i));
+    }
+    break;
+  }
+  case proto::Op::Details: {
+    std::string_view name = r.str();
+    std::string_view source = r.str();
+    if (!r.ok()) {
+      write_error(out, "malformed request");
+      return;
+    }
+    auto it = index.by_name.find(name);
+    if (it != index.by_name.end()) {
+      for (std::uint32_t i : it->second) {
+        if (source.empty() || index.packages[i].source == source) {
+          selected.push_back(i);
+          break;
+        }
+      }
+    }
+    break;
+  }
+  default:
+    write_error(out, "unknown request");
+    return;
+  }
+
+  write_packages(out, index, fields, selected);
+}
+
+bool socket_in_use(const std::string &path) {
+  proto::Connection probe;
+  return probe.open(path);
+}
+
+int listen_on(const std::string &path) {
+  sockaddr_un addr{};
+  if (path.size() >= sizeof(addr.sun_path)) {
+    return -1;
+  }
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  unlink(path.c_str());
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void watch_fd(int epoll_fd, int fd, std::uint32_t events) {
+  epoll_event ev{};
+  ev.events = events;
+  ev.data.fd = fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+void rewatch_fd(int epoll_fd, int fd, std::uint32_t events) {
+  epoll_event ev{};
+  ev.events = events;
+  ev.data.fd = fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void drain(int fd) {
+  char buffer[4096];
+  while (read(fd, buffer, sizeof(buffer)) > 0) {
+  }
+}
+
+class EventLoop {
+public:
+  EventLoop(std::shared_ptr<PackageManager> manager,
+            std::shared_ptr<const Index> index)
+      : manager_(std::move(manager)), index_(std::move(index)) {}
+
+  int run(int listen_fd, int inotify_fd, int signal_fd);
+
+private:
+  void accept_clients(int listen_fd);
+  void read_client(int fd);
+  void process(int fd, Client &client);
+  void flush(int fd, Client &client);
+  void close_client(int fd);
+  void start_reload();
+  void finish_reload();
+
+  std::shared_ptr<PackageManager> manager_;
+  std::shared_ptr<const Index> index_;
+  std::unordered_map<int, Client> clients_;
+
+  int epoll_fd_ = -1;
+  int timer_fd_ = -1;
+  int reload_fd_ = -1;
+
+  std::thread reloader_;
+  std::mutex reload_mutex_;
+  std::shared_ptr<const Index> reloaded_;
+  bool reload_again_ = false;
+};
+
+int EventLoop::run(int listen_fd, int inotify_fd, int signal_fd) {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  reload_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd_ < 0 || timer_fd_ < 0 || reload_fd_ < 0) {
+    return 1;
+  }
+
+  watch_fd(epoll_fd_, listen_fd, EPOLLIN);
+  watch_fd(epoll_fd_, signal_fd, EPOLLIN);
+  watch_fd(epoll_fd_, timer_fd_, EPOLLIN);
+  watch_fd(epoll_fd_, reload_fd_, EPOLLIN);
+  if (inotify_fd >= 0) {
+    watch_fd(epoll_fd_, inotify_fd, EPOLLIN);
+  }
+
+  epoll_event events[64];
+  bool running = true;
+  while (running) {
+    int n = epoll_wait(epoll_fd_, events, 64, -1);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      break;
+    }
+
+    for (int i = 0; i < n; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == listen_fd) {
+        accept_clients(listen_fd);
+      } else if (fd == signal_fd) {
+        running = false;
+      } else if (fd == inotify_fd) {
+        drain(inotify_fd);
+        itimerspec delay{};
+        delay.it_value.tv_nsec = reload_delay_ms * 1000000;
+        timerfd_settime(timer_fd_, 0, &delay, nullptr);
+      } else if (fd == timer_fd_) {
+        drain(timer_fd_);
+        start_reload();
+      } else if (fd == reload_fd_) {
+        drain(reload_fd_);
+        finish_reload();
+      } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+        close_client(fd);
+      } else {
+        auto it = clients_.find(fd);
+        if (it == clients_.end()) {
+          continue;
+        }
+        if (events[i].events & EPOLLOUT) {
+          flush(fd, it->second);
+        }
+        if ((events[i].events & EPOLLIN) && clients_.count(fd)) {
+          read_client(fd);
+        }
+      }
+    }
+  }
+
+  while (!clients_.empty()) {
+    close_client(clients_.begin()->first);
+  }
+  if (reloader_.joinable()) {
+    reloader_.join();
+  }
+  close(reload_fd_);
+  close(timer_fd_);
+  close(epoll_fd_);
+  return 0;
+}
+
+void EventLoop::accept_clients(int listen_fd) {
+  for (;;) {
+    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      return;
+    }
+    clients_.emplace(fd, Client{});
+    watch_fd(epoll_fd_, fd, EPOLLIN);
+  }
+}
+
+void EventLoop::read_client(int fd) {
+  Client &client = clients_[fd];
+  char buffer[65536];
+  for (;;) {
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n > 0) {
+      client.in.append(buffer, static_cast<std::size_t>(n));
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+      close_client(fd);
+      return;
+    }
+    break;
+  }
+  process(fd, client);
+}
+
+void EventLoop::process(int fd, Client &client) {
+  std::size_t offset = 0;
+  bool invalid = false;
+  while (client.out.size() - client.out_pos < max_pending_output) {
+    proto::Op op;
+    std::string_view payload;
+    std::size_t consumed = 0;
+    auto status = proto::next_frame(std::string_view(client.in).substr(offset),
+                                    op, payload, consumed);
+    if (status == proto::FrameStatus::Invalid) {
+      invalid = true;
+      break;
+    }
+    if (status == proto::FrameStatus::Incomplete) {
+      break;
+    }
+    handle_request(*index_, op, payload, client.out);
+    offset += consumed;
+  }
+  client.in.erase(0, offset);
+
+  if (invalid) {
+    close_client(fd);
+    return;
+  }
+  flush(fd, client);
+}
+
+void EventLoop::flush(int fd, Client &client) {
+  while (client.out_pos < client.out.size()) {
+    ssize_t n = send(fd, client.out.data() + client.out_pos,
+                     client.out.size() - client.out_pos, MSG_NOSIGNAL);
+    if (n > 0) {
+      client.out_pos += static_cast<std::size_t>(n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    close_client(fd);
+    return;
+  }
+
+  if (client.out_pos == client.out.size()) {
+    client.out.clear();
+    client.out_pos = 0;
+  }
+
+  bool pending = client.out_pos < client.out.size();
+  if (pending == client.writing) {
+    return;
+  }
+  client.writing = pending;
+  rewatch_fd(epoll_fd_, fd, pending ? EPOLLOUT : EPOLLIN);
+  if (!pending && !client.in.empty()) {
+    process(fd, client);
+  }
+}
+
+void EventLoop::close_client(int fd) {
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  clients_.erase(fd);
+}
+
+void EventLoop::start_reload() {
+  if (reloader_.joinable()) {
+    reload_again_ = true;
+    return;
+  }
+  reloader_ = std::thread([this] {
+    auto index = build_index(*manager_);
+    {
+      std::lock_guard<std::mutex> lock(reload_mutex_);
+      reloaded_ = std::move(index);
+    }
+    std::uint64_t one = 1;
+    if (write(reload_fd_, &one, sizeof(one)) < 0) {
+      std::perror("eventfd");
+    }
+  });
+}
+
+void EventLoop::finish_reload() {
+  reloader_.join();
+  {
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    index_ = std::move(reloaded_);
+  }
+  std::fprintf(stderr, "reloaded %zu packages\n", index_->packages.size());
+
+  if (reload_again_) {
+    reload_again_ = false;
+    start_reload();
+  }
+}
+
+} // namespace
+
+int run_daemon(std::shared_ptr<PackageManager> manager,
+               const std::string &socket_path,
+               const std::vector<std::string> &watch_paths) {
+  if (socket_in_use(socket_path)) {
+    std::fprintf(stderr, "daemon already listening on %s\n",
+                 socket_path.c_str());
+    return 1;
+  }
+
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigprocmask(SIG_BLOCK, &signals, nullptr);
+  int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+  int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  for (const auto &path : watch_paths) {
+    inotify_add_watch(inotify_fd, path.c_str(),
+                      IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_CLOSE_WRITE);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto index = build_index(*manager);
+  std::fprintf(stderr, "indexed %zu packages in %.1f ms\n",
+               index->packages.size(),
+               std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - start)
+                   .count());
+
+  int listen_fd = listen_on(socket_path);
+  if (listen_fd < 0 || signal_fd < 0) {
+    std::fprintf(stderr, "cannot listen on %s: %s\n", socket_path.c_str(),
+                 std::strerror(errno));
+    return 1;
+  }
+  std::fprintf(stderr, "listening on %s\n", socket_path.c_str());
+
+  EventLoop loop(std::move(manager), std::move(index));
+  int rc = loop.run(listen_fd, inotify_fd, signal_fd);
+
+  close(listen_fd);
+  unlink(socket_path.c_str());
+  if (inotify_fd >= 0) {
+    close(inotify_fd);
+  }
+  close(signal_fd);
+  return rc;
+}
+
+BenchResult benchmark_daemon(const std::string &socket_path, unsigned clients,
+                             std::size_t requests_per_client) {
+  using Clock = std::chrono::steady_clock;
+
+  BenchResult result;
+  std::vector<std::string> names;
+  {
+    proto::Connection connection;
+    std::string request;
+    proto::Writer(request).varint(field::Name);
+    proto::Op reply;
+    std::string payload;
+    if (!connection.open(socket_path) ||
+        !connection.call(proto::Op::List, request, reply, payload)) {
+      result.failures = 1;
+      return result;
+    }
+    proto::Reader r(payload);
+    auto fields = static_cast<FieldMask>(r.varint());
+    std::uint64_t count = r.varint();
+    proto::RecordLists lists(std::pmr::get_default_resource());
+    PackageRecord record;
+    for (std::uint64_t i = 0; i < count && r.ok(); ++i) {
+      if (proto::decode_package(r, fields, record, lists)) {
+        names.emplace_back(record.name);
+      }
+    }
+  }
+  if (names.empty()) {
+    names.emplace_back("bash");
+  }
+
+  clients = std::max(1u, clients);
+  std::vector<std::vector<double>> latencies(clients);
+  std::atomic<std::size_t> failures{0};
+  std::vector<std::thread> threads;
+  threads.reserve(clients);
+
+  auto start = Clock::now();
+  for (unsigned c = 0; c < clients; ++c) {
+    threads.emplace_back([&, c] {
+      proto::Connection connection;
+      if (!connection.open(socket_path)) {
+        failures += requests_per_client;
+        return;
+      }
+
+      auto &samples = latencies[c];
+      samples.reserve(requests_per_client);
+      std::string request;
+      std::string payload;
+      for (std::size_t i = 0; i < requests_per_client; ++i) {
+        request.clear();
+        proto::Writer w(request);
+        proto::Op op;
+        switch ((i + c) % 4) {
+        case 0:
+          op = proto::Op::List;
+          w.varint(field::Name | field::Version);
+          break;
+        case 1:
+          op = proto::Op::Search;
+          w.varint(field::Name | field::Version | field::Description);
+          w.str(names[(i * 7 + c) % names.size()].substr(0, 3));
+          break;
+        case 2:
+          op = proto::Op::Details;
+          w.varint(field::Name | field::Version | field::Description |
+                   field::DependsOn | field::RequiredBy);
+          w.str(names[(i * 13 + c) % names.size()]);
+          w.str("");
+          break;
+        default:
+          op = proto::Op::Filter;
+          w.varint(field::Name | field::Version);
+          w.u8(static_cast<std::uint8_t>(proto::FilterKind::Explicit));
+          break;
+        }
+
+        auto sent = Clock::now();
+        proto::Op reply;
+        if (!connection.call(op, request, reply, payload) ||
+            reply != proto::Op::Packages) {
+          ++failures;
+          continue;
+        }
+        samples.push_back(
+            std::chrono::duration<double, std::micro>(Clock::now() - sent)
+                .count());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  result.seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<double> all;
+  for (auto &samples : latencies) {
+    all.insert(all.end(), samples.begin(), samples.end());
+  }
+  result.requests = all.size();
+  result.failures = failures;
+  if (!all.empty()) {
+    std::sort(all.begin(), all.end());
+    result.p50_us = all[all.size() / 2];
+    result.p99_us = all[std::min(all.size() - 1, all.size() * 99 / 100)];
+    result.max_us = all.back();
+  }
+  return result;
+}
+
+} // namespace pkg
@@ -0,0 +1,126 @@
+#include "DependencyIndex.h"
+#include "Version.h"
+
+namespace pkg {
+
+void DependencyIndex::build(const std::vector<Package> &packages) {
+  providers_.clear();
+  providers_.reserve(packages.size());
+
+  int count = static_cast<int>(packages.size());
+  for (int i = 0; i < count; ++i) {
+    lookup_or_insert(providers_, packages[i].name).push_back({i, -1});
+  }
+  for (int i = 0; i < count; ++i) {
+    const auto &provides = packages[i].provides;
+    for (int p = 0; p < static_cast<int>(provides.size()); ++p) {
+      std::string_view name = parse_constraint(provides[p]).name;
+      lookup_or_insert(providers_, name).push_back({i, p});
+    }
+  }
+
+  edges_.assign(packages.size(), {});
+  broken_.assign(packages.size(), 0);
+  for (int i = 0; i < count; ++i) {
+    update(packages, i);
+  }
+}
+
+void DependencyIndex::update(const std::vector<Package> &packages, int index) {
+  const auto &depends_on = packages[index].depends_on;
+  auto &edges = edges_[index];
+  edges.clear();
+  edges.reserve(depends_on.size());
+  broken_[index] = 0;
+  for (const auto &dep : depends_on) {
+    edges.push_back(resolve(packages, index, dep));
+    if (!edges.back().satisfied) {
+      broken_[index] = 1;
+    }
+  }
+}
+
+const std::vector<DependencyIndex::Provider> &
+DependencyIndex::providers(std::string_view name) const {
+  static const std::vector<Provider> none;
+  auto it = providers_.find(name);
+  return it != providers_.end() ? it->second : none;
+}
+
+std::vector<BrokenDep> DependencyIndex::broken() const {
+  std::vector<BrokenDep> out;
+  for (int i = 0; i < static_cast<int>(edges_.size()); ++i) {
+    if (!broken_[i]) {
+      continue;
+    }
+    for (int d = 0; d < static_cast<int>(edges_[i].size()); ++d) {
+      if (!edges_[i][d].satisfied) {
+        out.push_back({i, d});
+      }
+    }
+  }
+  return out;
+}
+
+void DependencyIndex::link_required_by(std::vector<Package> &packages) const {
+  for (auto &pkg : packages) {
+    pkg.required_by.clear();
+  }
+  for (int i = 0; i < static_cast<int>(edges_.size()); ++i) {
+    for (const auto &edge : edges_[i]) {
+      if (edge.target < 0) {
+        continue;
+      }
+      auto &required_by = packages[edge.target].required_by;
+      if (required_by.empty() || required_by.back() != packages[i].name) {
+        required_by.push_back(packages[i].name);
+      }
+    }
+  }
+}
+
+ResolvedDep DependencyIndex::resolve(const std::vector<Package> &packages,
+                                     int from, std::string_view dep) const {
+  const Package &origin = packages[from];
+  VersionScheme scheme = scheme_for_source(origin.source);
+
+  ResolvedDep fallback;
+  while (true) {
+    std::size_t bar = dep.find('|');
+    Constraint wanted = parse_constraint(dep.substr(0, bar));
+
+    auto it = providers_.find(wanted.name);
+    if (it != providers_.end()) {
+      for (const auto &provider : it->second) {
+        const Package &candidate = packages[provider.package];
+        if (candidate.source != origin.source) {
+          continue;
+        }
+        if (fallback.target < 0) {
+          fallback.target = provider.package;
+        }
+
+        std::string_view version = candidate.version;
+        if (provider.provide >= 0) {
+          version =
+              parse_constraint(candidate.provides[provider.provide]).version;
+        }
+
+        if (wanted.op == VersionOp::Any ||
+            (!version.empty() &&
+             satisfies(version, wanted.op, wanted.version, scheme))) {
+          return {provider.package, true};
+        }
+      }
+    }
+
+    if (bar == std::string_view::npos) {
+      break;
+    }
+    dep.remove_prefix(bar + 1);
+  }
+
+  return fallback;
+}
+
+} // namespace pkg
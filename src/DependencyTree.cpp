@@ -0,0 +1,152 @@
+#include "DependencyTree.h"
+
+#include <algorithm>
+
+namespace pkg {
+
+void DependencyTree::reset(int root, const std::vector<Package> &packages,
+                           const DependencyIndex &deps) {
+  root_ = root;
+  cursor_ = 0;
+  rows_.clear();
+  expanded_.clear();
+  if (root < 0 || root >= static_cast<int>(packages.size())) {
+    return;
+  }
+
+  for (Direction direction : {Direction::Depends, Direction::RequiredBy}) {
+    Row header;
+    header.package = root;
+    header.direction = direction;
+    header.header = true;
+    header.leaf = !has_children(packages, deps, root, direction);
+    header.expanded = !header.leaf;
+    rows_.push_back(header);
+    if (header.expanded) {
+      expanded_.insert(key(root, direction));
+      children(packages, deps, header, rows_);
+    }
+  }
+}
+
+void DependencyTree::move(int delta) {
+  if (rows_.empty()) {
+    return;
+  }
+  cursor_ = std::clamp(cursor_ + delta, 0, static_cast<int>(rows_.size()) - 1);
+}
+
+bool DependencyTree::expand(const std::vector<Package> &packages,
+                            const DependencyIndex &deps,
+                            std::vector<int> &revealed) {
+  if (rows_.empty()) {
+    return false;
+  }
+  Row &row = rows_[cursor_];
+  if (row.expanded || row.leaf || row.package < 0) {
+    return false;
+  }
+  if (!expanded_.insert(key(row.package, row.direction)).second) {
+    row.seen = true;
+    return false;
+  }
+  row.seen = false;
+  row.expanded = true;
+
+  std::vector<Row> added;
+  children(packages, deps, row, added);
+  for (const auto &child : added) {
+    if (child.package >= 0) {
+      revealed.push_back(child.package);
+    }
+  }
+  rows_.insert(rows_.begin() + cursor_ + 1, added.begin(), added.end());
+  return true;
+}
+
+void DependencyTree::collapse() {
+  if (rows_.empty()) {
+    return;
+  }
+  Row &row = rows_[cursor_];
+  if (!row.expanded) {
+    for (int i = cursor_ - 1; i >= 0; --i) {
+      if (rows_[i].depth < row.depth) {
+        cursor_ = i;
+        break;
+      }
+    }
+    return;
+  }
+
+  std::size_t end = cursor_ + 1;
+  while (end < rows_.size() && rows_[end].depth > row.depth) {
+    if (rows_[end].expanded) {
+      expanded_.erase(key(rows_[end].package, rows_[end].direction));
+    }
+    ++end;
+  }
+  expanded_.erase(key(row.package, row.direction));
+  row.expanded = false;
+  rows_.erase(rows_.begin() + cursor_ + 1, rows_.begin() + end);
+}
+
+void DependencyTree::children(const std::vector<Package> &packages,
+                              const DependencyIndex &deps, const Row &parent,
+                              std::vector<Row> &out) const {
+  int owner = parent.package;
+  std::size_t count = 0;
+  if (parent.direction == Direction::Depends) {
+    if (owner < static_cast<int>(deps.size())) {
+      count = deps.depends(owner).size();
+    }
+  } else {
+    count = packages[owner].required_by.size();
+  }
+
+  out.reserve(out.size() + count);
+  for (std::size_t e = 0; e < count; ++e) {
+    Row row;
+    row.parent = owner;
+    row.edge = static_cast<int>(e);
+    row.depth = static_cast<std::uint16_t>(parent.depth + 1);
+    row.direction = parent.direction;
+    if (parent.direction == Direction::Depends) {
+      row.package = deps.depends(owner)[e].target;
+    } else {
+      row.package = resolve_dependent(packages, deps, owner, row.edge);
+    }
+    row.leaf = !has_children(packages, deps, row.package, row.direction);
+    row.seen = !row.leaf &&
+               expanded_.count(key(row.package, row.direction)) != 0;
+    out.push_back(row);
+  }
+}
+
+bool DependencyTree::has_children(const std::vector<Package> &packages,
+                                  const DependencyIndex &deps, int package,
+                                  Direction direction) const {
+  if (package < 0) {
+    return false;
+  }
+  if (direction == Direction::Depends) {
+    return package < static_cast<int>(deps.size()) &&
+           !deps.depends(package).empty();
+  }
+  return !packages[package].required_by.empty();
+}
+
+int DependencyTree::resolve_dependent(const std::vector<Package> &packages,
+                                      const DependencyIndex &deps, int package,
+                                      int edge) const {
+  const std::string &name = packages[package].required_by[edge];
+  for (const auto &provider : deps.providers(name)) {
+    if (provider.provide < 0 &&
+        packages[provider.package].source == packages[package].source) {
+      return provider.package;
+    }
+  }
+  return -1;
+}
+
+} // namespace pkg
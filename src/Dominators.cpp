@@ -0,0 +1,195 @@
+#include "Dominators.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace pkg {
+
+void DominatorTree::build(const std::vector<Package> &packages,
+                          const DependencyIndex &deps) {
+  int count = static_cast<int>(packages.size());
+  succ_.assign(count + 1, {});
+  pred_.assign(count + 1, {});
+  explicit_.assign(count, 0);
+  sizes_.assign(count, 0);
+
+  for (int i = 0; i < count; ++i) {
+    set_successors(deps, i);
+    sizes_[i] = packages[i].installed_size;
+    if (packages[i].is_explicit) {
+      explicit_[i] = 1;
+      link(root(), i);
+    }
+  }
+
+  number();
+
+  idom_.assign(count + 1, -1);
+  solve(std::vector<int>(rpo_.begin() + 1, rpo_.end()));
+  accumulate(packages);
+}
+
+void DominatorTree::update(const std::vector<Package> &packages,
+                           const DependencyIndex &deps, int changed) {
+  if (packages.size() + 1 != succ_.size() || deps.size() != packages.size() ||
+      static_cast<bool>(explicit_[changed]) != packages[changed].is_explicit ||
+      !same_successors(deps, changed)) {
+    build(packages, deps);
+    return;
+  }
+
+  std::uint64_t before = sizes_[changed];
+  std::uint64_t after = packages[changed].installed_size;
+  if (before == after) {
+    return;
+  }
+  sizes_[changed] = after;
+  for (int v = changed; v != root(); v = idom_[v]) {
+    footprint_[v].size = footprint_[v].size - before + after;
+  }
+  footprint_[root()].size = footprint_[root()].size - before + after;
+  ++revision_;
+}
+
+void DominatorTree::set_successors(const DependencyIndex &deps, int index) {
+  if (index >= static_cast<int>(deps.size())) {
+    return;
+  }
+  for (const auto &edge : deps.depends(index)) {
+    if (edge.target >= 0) {
+      link(index, edge.target);
+    }
+  }
+}
+
+bool DominatorTree::same_successors(const DependencyIndex &deps,
+                                    int index) const {
+  const auto &succ = succ_[index];
+  std::size_t next = 0;
+  for (const auto &edge : deps.depends(index)) {
+    if (edge.target < 0) {
+      continue;
+    }
+    if (next == succ.size() || succ[next] != edge.target) {
+      return false;
+    }
+    ++next;
+  }
+  return next == succ.size();
+}
+
+void DominatorTree::link(int from, int to) {
+  succ_[from].push_back(to);
+  pred_[to].push_back(from);
+}
+
+void DominatorTree::number() {
+  int count = root();
+  post_.assign(count + 1, -1);
+  std::vector<int> order;
+  order.reserve(count + 1);
+  std::vector<char> seen(count + 1, 0);
+  std::vector<std::pair<int, std::size_t>> stack;
+
+  auto visit = [&](int start) {
+    seen[start] = 1;
+    stack.push_back({start, 0});
+    while (!stack.empty()) {
+      auto &[v, next] = stack.back();
+      if (next < succ_[v].size()) {
+        int s = succ_[v][next++];
+        if (!seen[s]) {
+          seen[s] = 1;
+          stack.push_back({s, 0});
+        }
+      } else {
+        post_[v] = static_cast<int>(order.size());
+        order.push_back(v);
+        stack.pop_back();
+      }
+    }
+  };
+
+  seen[root()] = 1;
+  for (int s : std::vector<int>(succ_[root()])) {
+    if (!seen[s]) {
+      visit(s);
+    }
+  }
+  for (int v = 0; v < count; ++v) {
+    if (!seen[v]) {
+      link(root(), v);
+      visit(v);
+    }
+  }
+  post_[root()] = static_cast<int>(order.size());
+  order.push_back(root());
+
+  rpo_.assign(order.rbegin(), order.rend());
+}
+
+int DominatorTree::intersect(int a, int b) const {
+  while (a != b) {
+    while (post_[a] < post_[b]) {
+      a = idom_[a];
+    }
+    while (post_[b] < post_[a]) {
+      b = idom_[b];
+    }
+  }
+  return a;
+}
+
+void DominatorTree::solve(const std::vector<int> &nodes) {
+  for (int v : nodes) {
+    idom_[v] = -1;
+  }
+  idom_[root()] = root();
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int v : nodes) {
+      if (v == root()) {
+        continue;
+      }
+      int dom = -1;
+      for (int p : pred_[v]) {
+        if (idom_[p] < 0) {
+          continue;
+        }
+        dom = dom < 0 ? p : intersect(p, dom);
+      }
+      if (dom != idom_[v]) {
+        idom_[v] = dom;
+        changed = true;
+      }
+    }
+  }
+}
+
+void DominatorTree::accumulate(const std::vector<Package> &packages) {
+  std::vector<Footprint> footprint(succ_.size());
+  for (auto it = rpo_.rbegin(); it != rpo_.rend(); ++it) {
+    int v = *it;
+    Footprint &own = footprint[v];
+    own.count += 1;
+    if (v != root()) {
+      own.size += packages[v].installed_size;
+      footprint[idom_[v]].count += own.count;
+      footprint[idom_[v]].size += own.size;
+    }
+  }
+
+  bool changed = !std::equal(
+      footprint.begin(), footprint.end(), footprint_.begin(), footprint_.end(),
+      [](const Footprint &a, const Footprint &b) {
+        return a.count == b.count && a.size == b.size;
+      });
+  footprint_.swap(footprint);
+  if (changed) {
+    ++revision_;
+  }
+}
+
+} // namespace pkg
@@ -0,0 +1,464 @@
+#include "DpkgPackageManager.h"
+#include "MappedFile.h"
+#include "Version.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace pkg {
+
+namespace {
+
+struct Stanza {
+  std::string_view package;
+  std::string_view status;
+  std::string_view version;
+  std::string_view architecture;
+  std::string_view description;
+  std::string_view installed_size;
+  std::string_view depends;
+  std::string_view pre_depends;
+  std::string_view provides;
+  std::string_view conflicts;
+  std::string_view breaks;
+  std::string_view replaces;
+};
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() &&
+         (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+template <typename Fn> void for_each_stanza(std::string_view text, Fn &&fn) {
+  Stanza stanza;
+  bool in_stanza = false;
+  std::size_t pos = 0;
+
+  while (pos <= text.size()) {
+    std::size_t eol = text.find('\n', pos);
+    if (eol == std::string_view::npos) {
+      eol = text.size();
+    }
+    std::string_view line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+
+    if (trim(line).empty()) {
+      if (in_stanza) {
+        fn(stanza);
+        stanza = Stanza{};
+        in_stanza = false;
+      }
+      continue;
+    }
+
+    in_stanza = true;
+    if (line.front() == ' ' || line.front() == '\t') {
+      continue;
+    }
+
+    std::size_t colon = line.find(':');
+    if (colon == std::string_view::npos) {
+      continue;
+    }
+
+    std::string_view key = line.substr(0, colon);
+    std::string_view value = trim(line.substr(colon + 1));
+
+    if (key == "Package") {
+      stanza.package = value;
+    } else if (key == "Status") {
+      stanza.status = value;
+    } else if (key == "Version") {
+      stanza.version = value;
+    } else if (key == "Architecture") {
+      stanza.architecture = value;
+    } else if (key == "Description") {
+      stanza.description = value;
+    } else if (key == "Installed-Size") {
+      stanza.installed_size = value;
+    } else if (key == "Depends") {
+      stanza.depends = value;
+    } else if (key == "Pre-Depends") {
+      stanza.pre_depends = value;
+    } else if (key == "Provides") {
+      stanza.provides = value;
+    } else if (key == "Conflicts") {
+      stanza.conflicts = value;
+    } else if (key == "Breaks") {
+      stanza.breaks = value;
+    } else if (key == "Replaces") {
+      stanza.replaces = value;
+    }
+  }
+
+  if (in_stanza) {
+    fn(stanza);
+  }
+}
+
+bool is_installed(std::string_view status) {
+  std::size_t space = status.rfind(' ');
+  std::string_view state =
+      space == std::string_view::npos ? status : status.substr(space + 1);
+  return state == "installed";
+}
+
+std::string_view strip_qualifier(std::string_view alt, std::string_view &rest) {
+  std::size_t name_end = alt.find_first_of(" \t(");
+  std::string_view name = alt.substr(0, name_end);
+  rest = name_end == std::string_view::npos ? std::string_view{}
+                                            : alt.substr(name_end);
+  return name.substr(0, name.find(':'));
+}
+
+void append_relations(std::string_view raw,
+                      std::pmr::vector<std::string_view> &out,
+                      std::pmr::deque<std::pmr::string> &owned) {
+  while (!raw.empty()) {
+    std::size_t comma = raw.find(',');
+    std::string_view group = trim(raw.substr(0, comma));
+    raw = comma == std::string_view::npos ? std::string_view{}
+                                          : raw.substr(comma + 1);
+    if (group.empty()) {
+      continue;
+    }
+
+    std::size_t name_end = group.find_first_of(" \t(|");
+    if (group.substr(0, name_end).find(':') == std::string_view::npos &&
+        group.find(':', name_end) == std::string_view::npos) {
+      out.push_back(group);
+      continue;
+    }
+
+    auto &text = owned.emplace_back();
+    while (!group.empty()) {
+      std::size_t bar = group.find('|');
+      std::string_view rest;
+      std::string_view name =
+          strip_qualifier(trim(group.substr(0, bar)), rest);
+      if (!text.empty()) {
+        text.append(" | ");
+      }
+      text.append(name).append(rest);
+      group = bar == std::string_view::npos ? std::string_view{}
+                                            : group.substr(bar + 1);
+    }
+    out.push_back(text);
+  }
+}
+
+void format_install_date(int info_fd, std::string_view name,
+                         std::string_view arch, std::pmr::string &out) {
+  out.clear();
+  if (info_fd < 0) {
+    return;
+  }
+
+  struct stat st {};
+  std::pmr::string list(out.get_allocator());
+  list.append(name).append(".list");
+  if (fstatat(info_fd, list.c_str(), &st, 0) != 0) {
+    list.assign(name).append(":").append(arch).append(".list");
+    if (fstatat(info_fd, list.c_str(), &st, 0) != 0) {
+      return;
+    }
+  }
+
+  std::tm tm{};
+  time_t mtime = st.st_mtime;
+  localtime_r(&mtime, &tm);
+
+  std::array<char, 64> buffer{};
+  std::size_t n = std::strftime(buffer.data(), buffer.size(),
+                                "%a %d %b %Y %I:%M:%S %p %Z", &tm);
+  out.assign(buffer.data(), n);
+}
+
+std::optional<std::unordered_set<std::string>>
+read_auto_installed(const std::string &path) {
+  MappedFile file(path);
+  if (!file.ok()) {
+    return std::nullopt;
+  }
+
+  std::unordered_set<std::string> auto_set;
+  std::string_view text = file.view();
+  std::string_view current;
+  std::size_t pos = 0;
+
+  while (pos < text.size()) {
+    std::size_t eol = text.find('\n', pos);
+    if (eol == std::string_view::npos) {
+      eol = text.size();
+    }
+    std::string_view line = trim(text.substr(pos, eol - pos));
+    pos = eol + 1;
+
+    if (line.empty()) {
+      current = {};
+    } else if (line.substr(0, 8) == "Package:") {
+      current = trim(line.substr(8));
+    } else if (line.substr(0, 15) == "Auto-Installed:") {
+      if (trim(line.substr(15)) == "1" && !current.empty()) {
+        auto_set.emplace(current);
+      }
+    }
+  }
+
+  return auto_set;
+}
+
+std::unordered_set<std::string> get_manual_packages() {
+  std::unordered_set<std::string> manual;
+
+  const char *cmd = "apt-mark showmanual 2>/dev/null";
+
+  FILE *fp = popen(cmd, "r");
+  if (!fp) {
+    return manual;
+  }
+
+  std::array<char, 4096> buffer{};
+
+  while (fgets(buffer.data(), static_cast<int>(buffer.size()), fp) != nullptr) {
+    std::string_view line(buffer.data());
+    if (!line.empty() && line.back() == '\n') {
+      line.remove_suffix(1);
+    }
+    line = trim(line);
+    if (!line.empty()) {
+      manual.emplace(line.substr(0, line.find(':')));
+    }
+  }
+
+  pclose(fp);
+  return manual;
+}
+
+std::string info_dir_for(const std::string &status_path) {
+  std::size_t slash = status_path.rfind('/');
+  if (slash == std::string::npos) {
+    return "info";
+  }
+  return status_path.substr(0, slash + 1) + "info";
+}
+
+} // namespace
+
+DpkgPackageManager::DpkgPackageManager(std::string status_path,
+                                       std::string extended_states_path)
+    : status_path_(std::move(status_path)),
+      extended_states_path_(std::move(extended_states_path)) {}
+
+void DpkgPackageManager::visitInstalled(FieldMask fields,
+                                        const PackageVisitor &visit,
+                                        std::pmr::memory_resource *scratch) {
+  MappedFile status(status_path_);
+  if (!status.ok()) {
+    return;
+  }
+
+  std::optional<std::unordered_set<std::string>> auto_set;
+  std::unordered_set<std::string> manual;
+  if (fields & field::Explicit) {
+    auto_set = read_auto_installed(extended_states_path_);
+    if (!auto_set) {
+      manual = get_manual_packages();
+    }
+  }
+
+  int info_fd = -1;
+  if (fields & field::InstallDate) {
+    std::string info_dir = info_dir_for(status_path_);
+    info_fd = open(info_dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  }
+
+  std::pmr::string install_date(scratch);
+  std::pmr::deque<std::pmr::string> owned(scratch);
+  std::pmr::vector<std::string_view> depends_on(scratch);
+  std::pmr::vector<std::string_view> provides(scratch);
+  std::pmr::vector<std::string_view> conflicts(scratch);
+  std::pmr::vector<std::string_view> replaces(scratch);
+
+  auto collect_depends = [&](const Stanza &s,
+                             std::pmr::vector<std::string_view> &out) {
+    out.clear();
+    if (fields & (field::DependsOn | field::RequiredBy)) {
+      append_relations(s.pre_depends, out, owned);
+      append_relations(s.depends, out, owned);
+    }
+  };
+
+  auto emit = [&](const Stanza &s, std::span<const std::string_view> deps,
+                  std::span<const std::string_view> required_by) {
+    PackageRecord record;
+    record.name = s.package;
+    record.version = s.version;
+    if (fields & field::Description) {
+      record.description = s.description;
+    }
+    if (fields & field::Architecture) {
+      record.architecture = s.architecture;
+    }
+    if (fields & field::InstallDate) {
+      format_install_date(info_fd, s.package, s.architecture, install_date);
+      record.install_date = install_date;
+    }
+    if (fields & field::InstalledSize) {
+      std::uint64_t kib = 0;
+      std::from_chars(s.installed_size.data(),
+                      s.installed_size.data() + s.installed_size.size(), kib);
+      record.installed_size = kib * 1024;
+    }
+    if (fields & field::DependsOn) {
+      record.depends_on = deps;
+    }
+    record.required_by = required_by;
+    if (fields & field::Provides) {
+      provides.clear();
+      append_relations(s.provides, provides, owned);
+      record.provides = provides;
+    }
+    if (fields & field::Conflicts) {
+      conflicts.clear();
+      append_relations(s.conflicts, conflicts, owned);
+      append_relations(s.breaks, conflicts, owned);
+      record.conflicts = conflicts;
+    }
+    if (fields & field::Replaces) {
+      replaces.clear();
+      append_relations(s.replaces, replaces, owned);
+      record.replaces = replaces;
+    }
+
+    if (fields & field::Explicit) {
+      std::string name(s.package);
+      if (auto_set) {
+        record.is_explicit = auto_set->find(name) == auto_set->end();
+      } else {
+        record.is_explicit = manual.find(name) != manual.end();
+      }
+    }
+
+    visit(record);
+  };
+
+  if (!(fields & field::RequiredBy)) {
+    for_each_stanza(status.view(), [&](const Stanza &s) {
+      if (s.package.empty() || !is_installed(s.status)) {
+        return;
+      }
+      owned.clear();
+      collect_depends(s, depends_on);
+      emit(s, depends_on, {});
+    });
+  } else {
+    std::pmr::vector<Stanza> stanzas(scratch);
+    for_each_stanza(status.view(), [&](const Stanza &s) {
+      if (!s.package.empty() && is_installed(s.status)) {
+        stanzas.push_back(s);
+      }
+    });
+
+    std::pmr::vector<std::pmr::vector<std::string_view>> depends(
+        stanzas.size(), scratch);
+    std::pmr::unordered_map<std::string_view, std::size_t> by_name(scratch);
+    by_name.reserve(stanzas.size());
+    for (std::size_t i = 0; i < stanzas.size(); ++i) {
+      collect_depends(stanzas[i], depends[i]);
+      by_name.emplace(stanzas[i].package, i);
+    }
+
+    std::pmr::vector<std::pmr::vector<std::string_view>> required_by(
+        stanzas.size(), scratch);
+    for (std::size_t i = 0; i < stanzas.size(); ++i) {
+      for (auto dep : depends[i]) {
+        while (true) {
+          std::size_t bar = dep.find('|');
+          auto it = by_name.find(parse_constraint(dep.substr(0, bar)).name);
+          if (it != by_name.end()) {
+            required_by[it->second].push_back(stanzas[i].package);
+            break;
+          }
+          if (bar == std::string_view::npos) {
+            break;
+          }
+          dep.remove_prefix(bar + 1);
+        }
+      }
+    }
+
+    for (std::size_t i = 0; i < stanzas.size(); ++i) {
+      emit(stanzas[i], depends[i], required_by[i]);
+    }
+  }
+
+  if (info_fd >= 0) {
+    close(info_fd);
+  }
+}
+
+bool DpkgPackageManager::fillDetails(Package &) { return true; }
+
+bool DpkgPackageManager::listFiles(const Package &pkg,
+                                   std::vector<FileEntry> &out) {
+  out.clear();
+
+  std::string info_dir = info_dir_for(status_path_);
+  MappedFile sums(info_dir + "/" + pkg.name + ".md5sums");
+  if (!sums.ok() && !pkg.architecture.empty()) {
+    sums = MappedFile(info_dir + "/" + pkg.name + ":" + pkg.architecture +
+                      ".md5sums");
+  }
+  if (!sums.ok()) {
+    return false;
+  }
+
+  std::string_view text = sums.view();
+  std::size_t pos = 0;
+  while (pos < text.size()) {
+    std::size_t eol = text.find('\n', pos);
+    if (eol == std::string_view::npos) {
+      eol = text.size();
+    }
+    std::string_view line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+
+    std::size_t space = line.find(' ');
+    if (space == std::string_view::npos) {
+      continue;
+    }
+    std::string_view path = trim(line.substr(space + 1));
+    if (path.empty()) {
+      continue;
+    }
+
+    FileEntry entry;
+    entry.path = path;
+    entry.md5 = line.substr(0, space);
+    out.push_back(std::move(entry));
+  }
+  return true;
+}
+
+} // namespace pkg
@@ -1,41 +1,81 @@
 #include "DummyPackageManager.h"
 
+#include <array>
+#include <charconv>
+#include <string>
+#include <string_view>
+
 namespace pkg {
 
-std::vector<Package> DummyPackageManager::listInstalled() {
-  std::vector<Package> result;
-  result.reserve(50);
-
-  for (int i = 1; i <= 50; ++i) {
-    Package p;
-    p.name = "package-" + std::to_string(i);
-    p.version = "1.0." + std::to_string(i % 10);
-    p.description = "Dummy package number " + std::to_string(i);
-    p.repo = "dummy";
-    p.architecture = "x86_64";
-    p.install_date = "N/A";
-
-    if (i > 1) {
-      p.depends_on.push_back("package-" + std::to_string(i - 1));
+namespace {
+
+void assign_numbered(std::pmr::string &out, std::string_view prefix,
+                     int value) {
+  std::array<char, 16> digits{};
+  auto end = std::to_chars(digits.data(), digits.data() + digits.size(), value)
+                 .ptr;
+  out.assign(prefix);
+  out.append(digits.data(), end);
+}
+
+} // namespace
+
+void DummyPackageManager::visitInstalled(FieldMask fields,
+                                         const PackageVisitor &visit,
+                                         std::pmr::memory_resource *scratch) {
+  std::pmr::string name(scratch);
+  std::pmr::string version(scratch);
+  std::pmr::string description(scratch);
+  std::pmr::string dep(scratch);
+  std::pmr::string req(scratch);
+
+  for (int i = 1; i <= count_; ++i) {
+    PackageRecord record;
+
+    assign_numbered(name, "package-", i);
+    record.name = name;
+
+    if (fields & field::Version) {
+      assign_numbered(version, "1.0.", i % 10);
+      record.version = version;
+    }
+    if (fields & field::Description) {
+      assign_numbered(description, "Dummy package number ", i);
+      record.description = description;
     }
-    if (i < 50) {
-      p.required_by.push_back("package-" + std::to_string(i + 1));
+    record.repo = "dummy";
+    record.architecture = "x86_64";
+    record.install_date = "N/A";
+    if (fields & field::InstalledSize) {
+      record.installed_size = static_cast<std::uint64_t>(i) * 48 * 1024;
+    }
+
+    std::string_view dep_view;
+    if ((fields & field::DependsOn) && i > 1) {
+      assign_numbered(dep, "package-", i - 1);
+      dep_view = dep;
+      record.depends_on = {&dep_view, 1};
+    }
+
+    std::string_view req_view;
+    if ((fields & field::RequiredBy) && i < count_) {
+      assign_numbered(req, "package-", i + 1);
+      req_view = req;
+      record.required_by = {&req_view, 1};
     }
 
     if (i % 5 == 0) {
-      p.is_foreign = true;
+      record.is_foreign = true;
     }
 
     if (i % 2 == 1) {
-      p.is_explicit = true;
+      record.is_explicit = true;
     } else {
-      p.is_explicit = false;
+      record.is_explicit = false;
     }
 
-    result.push_back(std::move(p));
+    visit(record);
   }
-
-  return result;
 }
 
 bool DummyPackageManager::fillDetails(Package &) { return true; }
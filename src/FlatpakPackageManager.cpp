@@ -0,0 +1,114 @@
+#include "FlatpakPackageManager.h"
+
+#include <array>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace pkg {
+
+namespace {
+
+std::vector<std::string> read_command_lines(const std::string &cmd) {
+  std::vector<std::string> lines;
+
+  FILE *fp = popen(cmd.c_str(), "r");
+  if (!fp) {
+    return lines;
+  }
+
+  std::array<char, 4096> buffer{};
+
+  while (fgets(buffer.data(), static_cast<int>(buffer.size()), fp) != nullptr) {
+    std::string line(buffer.data());
+    if (!line.empty() && line.back() == '\n') {
+      line.pop_back();
+    }
+    if (!line.empty()) {
+      lines.push_back(std::move(line));
+    }
+  }
+
+  pclose(fp);
+  return lines;
+}
+
+std::vector<std::string> split_tabs(const std::string &line) {
+  std::vector<std::string> fields;
+  std::size_t start = 0;
+  while (true) {
+    std::size_t tab = line.find('\t', start);
+    fields.push_back(line.substr(start, tab - start));
+    if (tab == std::string::npos) {
+      break;
+    }
+    start = tab + 1;
+  }
+  return fields;
+}
+
+void append_refs(bool is_app, FieldMask wanted, std::vector<Package> &out) {
+  bool description = wanted & field::Description;
+  bool runtime = is_app && (wanted & (field::DependsOn | field::RequiredBy));
+
+  std::string cmd = is_app ? "flatpak list --app " : "flatpak list --runtime ";
+  cmd += "--columns=application,version,branch,arch,origin";
+  if (description) {
+    cmd += ",description";
+  }
+  if (runtime) {
+    cmd += ",runtime";
+  }
+  cmd += " 2>/dev/null";
+
+  for (const auto &line : read_command_lines(cmd)) {
+    auto fields = split_tabs(line);
+    if (fields.size() < 5 || fields[0].empty()) {
+      continue;
+    }
+
+    Package pkg;
+    pkg.name = fields[0];
+    pkg.version = !fields[1].empty() ? fields[1] : fields[2];
+    pkg.architecture = fields[3];
+    pkg.repo = fields[4];
+    std::size_t next = 5;
+    if (description && fields.size() > next) {
+      pkg.description = fields[next++];
+    }
+    if (runtime && fields.size() > next && !fields[next].empty()) {
+      pkg.depends_on.push_back(fields[next].substr(0, fields[next].find('/')));
+    }
+    pkg.is_explicit = is_app;
+
+    out.push_back(std::move(pkg));
+  }
+}
+
+} // namespace
+
+std::vector<Package> FlatpakPackageManager::listInstalled() {
+  return listPackages(field::All);
+}
+
+std::vector<Package> FlatpakPackageManager::listPackages(FieldMask fields) {
+  std::vector<Package> packages;
+
+  append_refs(true, fields, packages);
+  append_refs(false, fields, packages);
+
+  if (fields & field::RequiredBy) {
+    link_required_by(packages);
+  }
+  return packages;
+}
+
+void FlatpakPackageManager::visitInstalled(FieldMask fields,
+                                           const PackageVisitor &visit,
+                                           std::pmr::memory_resource *scratch) {
+  visit_packages(listPackages(fields), fields, visit, scratch);
+}
+
+bool FlatpakPackageManager::fillDetails(Package &) { return true; }
+
+} // namespace pkg
@@ -0,0 +1,468 @@
+#include "History.h"
+#include "Version.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <ctime>
+#include <thread>
+#include <utility>
+
+namespace pkg {
+
+namespace {
+
+enum class LogFormat { Pacman, Dpkg };
+
+constexpr std::size_t min_chunk_size = 1u << 20;
+
+struct DateTime {
+  std::int64_t seconds = 0;
+  bool has_offset = false;
+};
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() &&
+         (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+bool parse_digits(std::string_view s, std::size_t &pos, std::size_t count,
+                  int &out) {
+  if (pos + count > s.size()) {
+    return false;
+  }
+  out = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    char c = s[pos + i];
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    out = out * 10 + (c - '0');
+  }
+  pos += count;
+  return true;
+}
+
+bool expect(std::string_view s, std::size_t &pos, char c) {
+  if (pos >= s.size() || s[pos] != c) {
+    return false;
+  }
+  ++pos;
+  return true;
+}
+
+std::int64_t days_from_civil(int y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  int era = (y >= 0 ? y : y - 399) / 400;
+  unsigned yoe = static_cast<unsigned>(y - era * 400);
+  unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return static_cast<std::int64_t>(era) * 146097 + doe - 719468;
+}
+
+bool parse_datetime(std::string_view s, std::size_t &pos, DateTime &out) {
+  int year, month, day;
+  if (!parse_digits(s, pos, 4, year) || !expect(s, pos, '-') ||
+      !parse_digits(s, pos, 2, month) || !expect(s, pos, '-') ||
+      !parse_digits(s, pos, 2, day) || month < 1 || month > 12 || day < 1 ||
+      day > 31) {
+    return false;
+  }
+
+  int hour = 0, minute = 0, second = 0;
+  if (pos < s.size() && (s[pos] == 'T' || s[pos] == ' ')) {
+    ++pos;
+    if (!parse_digits(s, pos, 2, hour) || !expect(s, pos, ':') ||
+        !parse_digits(s, pos, 2, minute)) {
+      return false;
+    }
+    if (pos < s.size() && s[pos] == ':' &&
+        !parse_digits(s, ++pos, 2, second)) {
+      return false;
+    }
+  }
+
+  out.seconds = days_from_civil(year, static_cast<unsigned>(month),
+                                static_cast<unsigned>(day)) *
+                    86400 +
+                hour * 3600 + minute * 60 + second;
+  out.has_offset = false;
+
+  if (pos < s.size() && s[pos] == 'Z') {
+    ++pos;
+    out.has_offset = true;
+  } else if (pos < s.size() && (s[pos] == '+' || s[pos] == '-')) {
+    int sign = s[pos] == '-' ? -1 : 1;
+    int off_hour, off_minute;
+    ++pos;
+    if (!parse_digits(s, pos, 2, off_hour)) {
+      return false;
+    }
+    expect(s, pos, ':');
+    if (!parse_digits(s, pos, 2, off_minute)) {
+      return false;
+    }
+    out.seconds -= sign * (off_hour * 3600 + off_minute * 60);
+    out.has_offset = true;
+  }
+  return true;
+}
+
+std::int64_t local_utc_offset(std::int64_t now) {
+  std::tm tm{};
+  time_t t = static_cast<time_t>(now);
+  localtime_r(&t, &tm);
+  return tm.tm_gmtoff;
+}
+
+bool pacman_action(std::string_view verb, HistoryAction &out) {
+  if (verb == "installed") {
+    out = HistoryAction::Installed;
+  } else if (verb == "upgraded") {
+    out = HistoryAction::Upgraded;
+  } else if (verb == "downgraded") {
+    out = HistoryAction::Downgraded;
+  } else if (verb == "reinstalled") {
+    out = HistoryAction::Reinstalled;
+  } else if (verb == "removed") {
+    out = HistoryAction::Removed;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool parse_pacman_line(std::string_view line, std::int64_t local_offset,
+                       HistoryEvent &ev) {
+  std::size_t close = line.find(']');
+  if (line.empty() || line.front() != '[' ||
+      close == std::string_view::npos) {
+    return false;
+  }
+
+  DateTime dt;
+  std::size_t pos = 0;
+  if (!parse_datetime(line.substr(1, close - 1), pos, dt)) {
+    return false;
+  }
+  ev.time = dt.has_offset ? dt.seconds : dt.seconds - local_offset;
+
+  std::string_view rest = trim(line.substr(close + 1));
+  if (!rest.empty() && rest.front() == '[') {
+    std::size_t tag_end = rest.find(']');
+    if (tag_end == std::string_view::npos ||
+        rest.substr(1, tag_end - 1) != "ALPM") {
+      return false;
+    }
+    rest = trim(rest.substr(tag_end + 1));
+  }
+
+  std::size_t space = rest.find(' ');
+  if (space == std::string_view::npos ||
+      !pacman_action(rest.substr(0, space), ev.action)) {
+    return false;
+  }
+  rest = rest.substr(space + 1);
+
+  std::size_t open = rest.find(" (");
+  std::size_t end = rest.rfind(')');
+  if (open == std::string_view::npos || end == std::string_view::npos ||
+      end < open) {
+    return false;
+  }
+  ev.package = rest.substr(0, open);
+  ev.source = "pacman";
+
+  std::string_view versions = rest.substr(open + 2, end - open - 2);
+  std::size_t arrow = versions.find(" -> ");
+  if (arrow != std::string_view::npos) {
+    ev.old_version = versions.substr(0, arrow);
+    ev.new_version = versions.substr(arrow + 4);
+  } else if (ev.action == HistoryAction::Removed) {
+    ev.old_version = versions;
+  } else {
+    ev.new_version = versions;
+  }
+  return true;
+}
+
+std::string_view next_field(std::string_view &rest) {
+  std::size_t space = rest.find(' ');
+  std::string_view field = rest.substr(0, space);
+  rest = space == std::string_view::npos ? std::string_view{}
+                                         : rest.substr(space + 1);
+  return field;
+}
+
+bool parse_dpkg_line(std::string_view line, std::int64_t local_offset,
+                     HistoryEvent &ev) {
+  DateTime dt;
+  std::size_t pos = 0;
+  if (!parse_datetime(line, pos, dt) || !expect(line, pos, ' ')) {
+    return false;
+  }
+  ev.time = dt.has_offset ? dt.seconds : dt.seconds - local_offset;
+
+  std::string_view rest = line.substr(pos);
+  std::string_view verb = next_field(rest);
+  if (verb != "install" && verb != "upgrade" && verb != "remove") {
+    return false;
+  }
+
+  std::string_view name = next_field(rest);
+  std::string_view old_version = next_field(rest);
+  std::string_view new_version = trim(next_field(rest));
+  if (name.empty() || old_version.empty()) {
+    return false;
+  }
+
+  ev.package = name.substr(0, name.find(':'));
+  ev.source = "dpkg";
+  ev.old_version = old_version == "<none>" ? std::string_view{} : old_version;
+  ev.new_version = new_version == "<none>" ? std::string_view{} : new_version;
+
+  if (verb == "remove") {
+    ev.action = HistoryAction::Removed;
+  } else if (ev.old_version.empty()) {
+    ev.action = HistoryAction::Installed;
+  } else {
+    int cmp = vercmp(ev.new_version, ev.old_version, VersionScheme::Debian);
+    ev.action = cmp > 0   ? HistoryAction::Upgraded
+                : cmp < 0 ? HistoryAction::Downgraded
+                          : HistoryAction::Reinstalled;
+  }
+  return true;
+}
+
+void parse_chunk(std::string_view text, LogFormat format,
+                 std::int64_t local_offset, std::vector<HistoryEvent> &out) {
+  std::size_t pos = 0;
+  while (pos < text.size()) {
+    std::size_t eol = text.find('\n', pos);
+    if (eol == std::string_view::npos) {
+      eol = text.size();
+    }
+    std::string_view line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+
+    HistoryEvent ev;
+    bool ok = format == LogFormat::Pacman
+                  ? parse_pacman_line(line, local_offset, ev)
+                  : parse_dpkg_line(line, local_offset, ev);
+    if (ok) {
+      out.push_back(ev);
+    }
+  }
+}
+
+std::vector<std::string_view> split_chunks(std::string_view text,
+                                           unsigned threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::size_t parts = std::min<std::size_t>(
+      threads, std::max<std::size_t>(text.size() / min_chunk_size, 1));
+
+  std::vector<std::string_view> chunks;
+  std::size_t begin = 0;
+  for (std::size_t i = 1; i <= parts && begin < text.size(); ++i) {
+    std::size_t end = text.size();
+    if (i < parts) {
+      end = text.find('\n', std::max(begin, text.size() / parts * i));
+      end = end == std::string_view::npos ? text.size() : end + 1;
+    }
+    chunks.push_back(text.substr(begin, end - begin));
+    begin = end;
+  }
+  return chunks;
+}
+
+bool by_time(const HistoryEvent &a, const HistoryEvent &b) {
+  return a.time < b.time;
+}
+
+} // namespace
+
+std::string_view action_label(HistoryAction action) {
+  switch (action) {
+  case HistoryAction::Installed:
+    return "installed";
+  case HistoryAction::Upgraded:
+    return "upgraded";
+  case HistoryAction::Downgraded:
+    return "downgraded";
+  case HistoryAction::Reinstalled:
+    return "reinstalled";
+  case HistoryAction::Removed:
+    return "removed";
+  }
+  return "";
+}
+
+bool parse_time_spec(std::string_view spec, std::int64_t now,
+                     std::int64_t &out) {
+  spec = trim(spec);
+  if (spec.empty()) {
+    return false;
+  }
+
+  std::size_t digits = 0;
+  while (digits < spec.size() && spec[digits] >= '0' && spec[digits] <= '9') {
+    ++digits;
+  }
+  if (digits > 0 && digits + 1 == spec.size()) {
+    std::int64_t amount = 0;
+    for (std::size_t i = 0; i < digits; ++i) {
+      amount = amount * 10 + (spec[i] - '0');
+    }
+    std::int64_t unit = 0;
+    switch (spec.back()) {
+    case 's':
+      unit = 1;
+      break;
+    case 'm':
+      unit = 60;
+      break;
+    case 'h':
+      unit = 3600;
+      break;
+    case 'd':
+      unit = 86400;
+      break;
+    case 'w':
+      unit = 7 * 86400;
+      break;
+    default:
+      return false;
+    }
+    out = now - amount * unit;
+    return true;
+  }
+
+  DateTime dt;
+  std::size_t pos = 0;
+  if (!parse_datetime(spec, pos, dt) || pos != spec.size()) {
+    return false;
+  }
+  out = dt.has_offset ? dt.seconds : dt.seconds - local_utc_offset(now);
+  return true;
+}
+
+std::string format_timestamp(std::int64_t time) {
+  std::tm tm{};
+  time_t t = static_cast<time_t>(time);
+  localtime_r(&t, &tm);
+
+  std::array<char, 32> buffer{};
+  std::size_t n =
+      std::strftime(buffer.data(), buffer.size(), "%Y-%m-%d %H:%M", &tm);
+  return std::string(buffer.data(), n);
+}
+
+bool History::load(const std::string &path, unsigned threads) {
+  MappedFile file(path);
+  if (!file.ok()) {
+    return false;
+  }
+
+  std::string_view text = file.view();
+  std::string_view head = trim(text.substr(0, text.find('\n')));
+  LogFormat format = !head.empty() && head.front() == '['
+                         ? LogFormat::Pacman
+                         : LogFormat::Dpkg;
+  std::int64_t local_offset = local_utc_offset(std::time(nullptr));
+
+  std::vector<std::string_view> chunks = split_chunks(text, threads);
+  std::vector<std::vector<HistoryEvent>> partial(chunks.size());
+
+  std::vector<std::thread> pool;
+  pool.reserve(chunks.size());
+  for (std::size_t i = 1; i < chunks.size(); ++i) {
+    pool.emplace_back([&, i] {
+      parse_chunk(chunks[i], format, local_offset, partial[i]);
+    });
+  }
+  if (!chunks.empty()) {
+    parse_chunk(chunks[0], format, local_offset, partial[0]);
+  }
+  for (auto &thread : pool) {
+    thread.join();
+  }
+
+  std::size_t total = events_.size();
+  for (const auto &part : partial) {
+    total += part.size();
+  }
+
+  auto first_new = static_cast<std::ptrdiff_t>(events_.size());
+  events_.reserve(total);
+  for (const auto &part : partial) {
+    events_.insert(events_.end(), part.begin(), part.end());
+  }
+
+  if (!std::is_sorted(events_.begin() + first_new, events_.end(), by_time)) {
+    std::stable_sort(events_.begin() + first_new, events_.end(), by_time);
+  }
+  std::inplace_merge(events_.begin(), events_.begin() + first_new,
+                     events_.end(), by_time);
+
+  files_.push_back(std::move(file));
+  rebuild_index();
+  return true;
+}
+
+std::span<const HistoryEvent> History::since(std::int64_t time) const {
+  auto it = std::partition_point(
+      events_.begin(), events_.end(),
+      [time](const HistoryEvent &ev) { return ev.time < time; });
+  return {it, events_.end()};
+}
+
+std::vector<const HistoryEvent *>
+History::for_package(std::string_view name, std::string_view source) const {
+  std::vector<const HistoryEvent *> out;
+  auto it = by_package_.find(name);
+  if (it == by_package_.end()) {
+    return out;
+  }
+  for (std::uint32_t i : it->second) {
+    if (source.empty() || events_[i].source == source) {
+      out.push_back(&events_[i]);
+    }
+  }
+  return out;
+}
+
+bool History::changed_since(std::string_view name, std::string_view source,
+                            std::int64_t time) const {
+  auto it = by_package_.find(name);
+  if (it == by_package_.end()) {
+    return false;
+  }
+  for (auto i = it->second.rbegin(); i != it->second.rend(); ++i) {
+    const auto &ev = events_[*i];
+    if (ev.time < time) {
+      return false;
+    }
+    if (source.empty() || ev.source == source) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void History::rebuild_index() {
+  by_package_.clear();
+  for (std::size_t i = 0; i < events_.size(); ++i) {
+    lookup_or_insert(by_package_, events_[i].package)
+        .push_back(static_cast<std::uint32_t>(i));
+  }
+}
+
+} // namespace pkg
@@ -0,0 +1,70 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+namespace pkg {
+
+MappedFile::MappedFile(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+
+  struct stat st {};
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return;
+  }
+
+  if (st.st_size == 0) {
+    close(fd);
+    ok_ = true;
+    return;
+  }
+
+  void *addr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ,
+                    MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return;
+  }
+
+  madvise(addr, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+
+  data_ = addr;
+  size_ = static_cast<std::size_t>(st.st_size);
+  ok_ = true;
+}
+
+MappedFile::~MappedFile() { reset(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      ok_(std::exchange(other.ok_, false)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    reset();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    ok_ = std::exchange(other.ok_, false);
+  }
+  return *this;
+}
+
+void MappedFile::reset() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  ok_ = false;
+}
+
+} // namespace pkg
@@ -0,0 +1,249 @@
+#include "MemStats.h"
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace pkg {
+
+namespace {
+
+constexpr std::size_t header_size = alignof(std::max_align_t);
+
+struct Header {
+  std::uint64_t size;
+  MemTag tag;
+  bool tracked;
+};
+
+static_assert(sizeof(Header) <= header_size);
+
+struct Counters {
+  std::atomic<std::uint64_t> live_bytes{0};
+  std::atomic<std::uint64_t> live_blocks{0};
+  std::atomic<std::uint64_t> allocations{0};
+};
+
+Counters counters[mem_tag_count];
+thread_local MemTag current_tag = MemTag::Other;
+std::atomic<bool> enabled{false};
+
+void *allocate(std::size_t size) noexcept {
+  auto *raw = static_cast<char *>(std::malloc(size + header_size));
+  if (!raw) {
+    return nullptr;
+  }
+  auto *header = reinterpret_cast<Header *>(raw);
+  header->size = size;
+  header->tag = current_tag;
+  header->tracked = enabled.load(std::memory_order_relaxed);
+
+  if (header->tracked) {
+    Counters &c = counters[static_cast<std::size_t>(header->tag)];
+    c.live_bytes.fetch_add(size, std::memory_order_relaxed);
+    c.live_blocks.fetch_add(1, std::memory_order_relaxed);
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  return raw + header_size;
+}
+
+void *allocate_or_throw(std::size_t size) {
+  void *p = allocate(size);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void release(void *p) noexcept {
+  if (!p) {
+    return;
+  }
+
+  char *raw = static_cast<char *>(p) - header_size;
+  auto *header = reinterpret_cast<Header *>(raw);
+  if (header->tracked) {
+    Counters &c = counters[static_cast<std::size_t>(header->tag)];
+    c.live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+    c.live_blocks.fetch_sub(1, std::memory_order_relaxed);
+  }
+  std::free(raw);
+}
+
+std::uint64_t resident_bytes() {
+  std::FILE *fp = std::fopen("/proc/self/statm", "r");
+  if (!fp) {
+    return 0;
+  }
+  unsigned long long size = 0;
+  unsigned long long resident = 0;
+  int fields = std::fscanf(fp, "%llu %llu", &size, &resident);
+  std::fclose(fp);
+  if (fields != 2) {
+    return 0;
+  }
+  return resident * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+} // namespace
+
+std::string_view mem_tag_label(MemTag tag) {
+  switch (tag) {
+  case MemTag::Other:
+    return "other";
+  case MemTag::Backend:
+    return "backend";
+  case MemTag::Packages:
+    return "packages";
+  case MemTag::Index:
+    return "index";
+  case MemTag::History:
+    return "history";
+  case MemTag::Search:
+    return "search";
+  case MemTag::Render:
+    return "render";
+  }
+  return "";
+}
+
+void mem_stats_enable() { enabled.store(true, std::memory_order_relaxed); }
+
+bool mem_stats_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+MemScope::MemScope(MemTag tag) : previous_(current_tag) { current_tag = tag; }
+
+MemScope::~MemScope() { current_tag = previous_; }
+
+MemReport mem_report() {
+  MemReport report;
+  std::uint64_t blocks = 0;
+  for (std::size_t i = 0; i < mem_tag_count; ++i) {
+    MemTagStats &stats = report.tags[i];
+    stats.live_bytes = counters[i].live_bytes.load(std::memory_order_relaxed);
+    stats.live_blocks = counters[i].live_blocks.load(std::memory_order_relaxed);
+    stats.allocations = counters[i].allocations.load(std::memory_order_relaxed);
+    report.tracked_bytes += stats.live_bytes;
+    blocks += stats.live_blocks;
+  }
+
+  struct mallinfo2 info = mallinfo2();
+  report.malloc_in_use = info.uordblks + info.hblkhd;
+  std::uint64_t tracked_total = report.tracked_bytes + blocks * header_size;
+  if (report.malloc_in_use > tracked_total) {
+    report.untracked_bytes = report.malloc_in_use - tracked_total;
+  }
+  report.rss_bytes = resident_bytes();
+  return report;
+}
+
+std::uint64_t mem_allocations() {
+  std::uint64_t total = 0;
+  for (const auto &c : counters) {
+    total += c.allocations.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+void KeystrokeAllocations::begin() {
+  if (open_) {
+    return;
+  }
+  for (std::size_t i = 0; i < mem_tag_count; ++i) {
+    start_[i] = counters[i].allocations.load(std::memory_order_relaxed);
+  }
+  open_ = true;
+}
+
+void KeystrokeAllocations::end() {
+  if (!open_) {
+    return;
+  }
+  for (std::size_t i = 0; i < mem_tag_count; ++i) {
+    sums_[i] +=
+        counters[i].allocations.load(std::memory_order_relaxed) - start_[i];
+  }
+  ++keys_;
+  open_ = false;
+}
+
+std::uint64_t KeystrokeAllocations::total() const {
+  std::uint64_t total = 0;
+  for (std::uint64_t sum : sums_) {
+    total += sum;
+  }
+  return total;
+}
+
+void write_mem_json(std::FILE *out, const MemReport &report,
+                    const KeystrokeAllocations &keys) {
+  std::fprintf(out,
+               "{\"rss_bytes\":%llu,\"malloc_in_use_bytes\":%llu,"
+               "\"tracked_bytes\":%llu,\"untracked_bytes\":%llu,"
+               "\"subsystems\":{",
+               static_cast<unsigned long long>(report.rss_bytes),
+               static_cast<unsigned long long>(report.malloc_in_use),
+               static_cast<unsigned long long>(report.tracked_bytes),
+               static_cast<unsigned long long>(report.untracked_bytes));
+  for (std::size_t i = 0; i < mem_tag_count; ++i) {
+    std::string_view label = mem_tag_label(static_cast<MemTag>(i));
+    const MemTagStats &stats = report.tags[i];
+    std::fprintf(out,
+                 "%s\"%.*s\":{\"live_bytes\":%llu,\"live_blocks\":%llu,"
+                 "\"allocations\":%llu}",
+                 i ? "," : "", static_cast<int>(label.size()), label.data(),
+                 static_cast<unsigned long long>(stats.live_bytes),
+                 static_cast<unsigned long long>(stats.live_blocks),
+                 static_cast<unsigned long long>(stats.allocations));
+  }
+
+  double per_key = keys.keys() ? static_cast<double>(keys.total()) /
+                                     static_cast<double>(keys.keys())
+                               : 0.0;
+  std::fprintf(out,
+               "},\"keystrokes\":{\"keys\":%zu,\"allocations\":%llu,"
+               "\"allocations_per_key\":%.2f,\"by_subsystem\":{",
+               keys.keys(), static_cast<unsigned long long>(keys.total()),
+               per_key);
+  for (std::size_t i = 0; i < mem_tag_count; ++i) {
+    std::string_view label = mem_tag_label(static_cast<MemTag>(i));
+    std::fprintf(out, "%s\"%.*s\":%llu", i ? "," : "",
+                 static_cast<int>(label.size()), label.data(),
+                 static_cast<unsigned long long>(
+                     keys.by_tag(static_cast<MemTag>(i))));
+  }
+  std::fprintf(out, "}}}\n");
+}
+
+} // namespace pkg
+
+void *operator new(std::size_t size) { return pkg::allocate_or_throw(size); }
+
+void *operator new[](std::size_t size) { return pkg::allocate_or_throw(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return pkg::allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return pkg::allocate(size);
+}
+
+void operator delete(void *p) noexcept { pkg::release(p); }
+
+void operator delete[](void *p) noexcept { pkg::release(p); }
+
+void operator delete(void *p, std::size_t) noexcept { pkg::release(p); }
+
+void operator delete[](void *p, std::size_t) noexcept { pkg::release(p); }
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  pkg::release(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  pkg::release(p);
+}
@@ -0,0 +1,126 @@
+#include "PackageManager.h"
+#include "Version.h"
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace pkg {
+
+Package to_package(const PackageRecord &record) {
+  Package pkg;
+  pkg.name = std::string(record.name);
+  pkg.version = std::string(record.version);
+  pkg.description = std::string(record.description);
+  pkg.repo = std::string(record.repo);
+  pkg.architecture = std::string(record.architecture);
+  pkg.install_date = std::string(record.install_date);
+  pkg.installed_size = record.installed_size;
+  pkg.source = std::string(record.source);
+
+  pkg.depends_on.assign(record.depends_on.begin(), record.depends_on.end());
+  pkg.required_by.assign(record.required_by.begin(), record.required_by.end());
+  pkg.provides.assign(record.provides.begin(), record.provides.end());
+  pkg.conflicts.assign(record.conflicts.begin(), record.conflicts.end());
+  pkg.replaces.assign(record.replaces.begin(), record.replaces.end());
+
+  pkg.is_foreign = record.is_foreign;
+  pkg.is_explicit = record.is_explicit;
+  return pkg;
+}
+
+void link_required_by(std::vector<Package> &packages) {
+  std::unordered_multimap<std::string_view, std::size_t> by_name;
+  by_name.reserve(packages.size());
+  for (std::size_t i = 0; i < packages.size(); ++i) {
+    by_name.emplace(packages[i].name, i);
+    packages[i].required_by.clear();
+  }
+
+  for (const auto &pkg : packages) {
+    for (const auto &dep : pkg.depends_on) {
+      auto [first, last] = by_name.equal_range(parse_constraint(dep).name);
+      for (auto it = first; it != last; ++it) {
+        auto &target = packages[it->second];
+        if (target.source == pkg.source) {
+          target.required_by.push_back(pkg.name);
+        }
+      }
+    }
+  }
+}
+
+std::vector<Package> PackageManager::listInstalled() {
+  std::vector<Package> packages;
+  visitInstalled(field::All, [&](const PackageRecord &record) {
+    packages.push_back(to_package(record));
+  });
+  return packages;
+}
+
+void visit_packages(const std::vector<Package> &packages, FieldMask fields,
+                    const PackageVisitor &visit,
+                    std::pmr::memory_resource *scratch) {
+  std::pmr::vector<std::string_view> depends_on(scratch);
+  std::pmr::vector<std::string_view> required_by(scratch);
+  std::pmr::vector<std::string_view> provides(scratch);
+  std::pmr::vector<std::string_view> conflicts(scratch);
+  std::pmr::vector<std::string_view> replaces(scratch);
+
+  for (const auto &pkg : packages) {
+    PackageRecord record;
+    record.name = pkg.name;
+    record.version = pkg.version;
+    record.source = pkg.source;
+    if (fields & field::Description) {
+      record.description = pkg.description;
+    }
+    if (fields & field::Repo) {
+      record.repo = pkg.repo;
+    }
+    if (fields & field::Architecture) {
+      record.architecture = pkg.architecture;
+    }
+    if (fields & field::InstallDate) {
+      record.install_date = pkg.install_date;
+    }
+    if (fields & field::InstalledSize) {
+      record.installed_size = pkg.installed_size;
+    }
+    if (fields & field::Foreign) {
+      record.is_foreign = pkg.is_foreign;
+    }
+    if (fields & field::Explicit) {
+      record.is_explicit = pkg.is_explicit;
+    }
+
+    if (fields & field::DependsOn) {
+      depends_on.assign(pkg.depends_on.begin(), pkg.depends_on.end());
+      record.depends_on = depends_on;
+    }
+    if (fields & field::RequiredBy) {
+      required_by.assign(pkg.required_by.begin(), pkg.required_by.end());
+      record.required_by = required_by;
+    }
+    if (fields & field::Provides) {
+      provides.assign(pkg.provides.begin(), pkg.provides.end());
+      record.provides = provides;
+    }
+    if (fields & field::Conflicts) {
+      conflicts.assign(pkg.conflicts.begin(), pkg.conflicts.end());
+      record.conflicts = conflicts;
+    }
+    if (fields & field::Replaces) {
+      replaces.assign(pkg.replaces.begin(), pkg.replaces.end());
+      record.replaces = replaces;
+    }
+
+    visit(record);
+  }
+}
+
+bool PackageManager::listFiles(const Package &, std::vector<FileEntry> &) {
+  return false;
+}
+
+} // namespace pkg
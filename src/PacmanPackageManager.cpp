@@ -1,12 +1,23 @@
 #include "PacmanPackageManager.h"
+#include "Version.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
 
 #include <algorithm>
 #include <array>
 #include <cctype>
+#include <charconv>
 #include <cstdio>
+#include <ctime>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace pkg {
@@ -54,16 +65,8 @@ std::vector<std::string> split_dep_list(const std::string &raw) {
       token.pop_back();
     }
 
-    std::size_t idx = 0;
-    while (idx < token.size() &&
-           (std::isalnum(static_cast<unsigned char>(token[idx])) ||
-            token[idx] == '@' || token[idx] == '_' || token[idx] == '-' ||
-            token[idx] == '.')) {
-      ++idx;
-    }
-    std::string name = token.substr(0, idx);
-    if (!name.empty()) {
-      out.push_back(name);
+    if (!token.empty()) {
+      out.push_back(token);
     }
   }
 
@@ -97,99 +100,415 @@ std::unordered_set<std::string> get_foreign_packages() {
   return foreign;
 }
 
-std::unordered_set<std::string> get_explicit_packages() {
-  std::unordered_set<std::string> explicit_set;
-
-  const char *cmd = "pacman -Qeq 2>/dev/null";
-
-  FILE *fp = popen(cmd, "r");
-  if (!fp) {
-    return explicit_set;
+struct DescFields {
+  std::string_view description;
+  std::string_view architecture;
+  std::string_view install_date;
+  std::string_view size;
+  std::string_view reason;
+};
+
+struct Relations {
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  explicit Relations(allocator_type alloc = {})
+      : depends_on(alloc), provides(alloc), conflicts(alloc), replaces(alloc) {}
+
+  void clear() {
+    depends_on.clear();
+    provides.clear();
+    conflicts.clear();
+    replaces.clear();
   }
 
-  std::array<char, 4096> buffer{};
+  std::pmr::vector<std::string_view> depends_on;
+  std::pmr::vector<std::string_view> provides;
+  std::pmr::vector<std::string_view> conflicts;
+  std::pmr::vector<std::string_view> replaces;
+};
 
-  while (fgets(buffer.data(), static_cast<int>(buffer.size()), fp) != nullptr) {
-    std::string line(buffer.data());
-    if (!line.empty() && line.back() == '\n') {
-      line.pop_back();
+void parse_desc(std::string_view text, DescFields &out, Relations &rel) {
+  std::string_view key;
+  std::size_t pos = 0;
+
+  while (pos < text.size()) {
+    std::size_t eol = text.find('\n', pos);
+    if (eol == std::string_view::npos) {
+      eol = text.size();
     }
-    line = trim(line);
-    if (!line.empty()) {
-      explicit_set.insert(line);
+    std::string_view line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+
+    if (line.empty()) {
+      key = {};
+    } else if (line.size() > 2 && line.front() == '%' && line.back() == '%') {
+      key = line;
+    } else if (key == "%DESC%") {
+      if (out.description.empty()) {
+        out.description = line;
+      }
+    } else if (key == "%ARCH%") {
+      out.architecture = line;
+    } else if (key == "%INSTALLDATE%") {
+      out.install_date = line;
+    } else if (key == "%SIZE%") {
+      out.size = line;
+    } else if (key == "%REASON%") {
+      out.reason = line;
+    } else if (key == "%DEPENDS%") {
+      rel.depends_on.push_back(line);
+    } else if (key == "%PROVIDES%") {
+      rel.provides.push_back(line);
+    } else if (key == "%CONFLICTS%") {
+      rel.conflicts.push_back(line);
+    } else if (key == "%REPLACES%") {
+      rel.replaces.push_back(line);
     }
   }
+}
 
-  pclose(fp);
-  return explicit_set;
+bool split_entry_name(std::string_view entry, std::string_view &name,
+                      std::string_view &version) {
+  std::size_t rel = entry.rfind('-');
+  if (rel == std::string_view::npos || rel == 0) {
+    return false;
+  }
+  std::size_t ver = entry.rfind('-', rel - 1);
+  if (ver == std::string_view::npos || ver == 0) {
+    return false;
+  }
+  name = entry.substr(0, ver);
+  version = entry.substr(ver + 1);
+  return true;
 }
 
-} // namespace
+bool read_file(const std::string &path, std::pmr::string &out) {
+  out.clear();
 
-std::vector<Package> PacmanPackageManager::listInstalled() {
-  std::vector<Package> packages;
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  std::array<char, 4096> buffer{};
+  ssize_t n;
+  while ((n = read(fd, buffer.data(), buffer.size())) > 0) {
+    out.append(buffer.data(), static_cast<std::size_t>(n));
+  }
 
-  auto foreign = get_foreign_packages();
-  auto explicit_set = get_explicit_packages();
+  close(fd);
+  return n == 0;
+}
 
-  const char *cmd = "pacman -Q";
+void format_install_date(std::string_view epoch, std::pmr::string &out) {
+  out.clear();
 
-  FILE *fp = popen(cmd, "r");
-  if (!fp) {
-    return packages;
+  long long value = 0;
+  auto [ptr, ec] =
+      std::from_chars(epoch.data(), epoch.data() + epoch.size(), value);
+  if (ec != std::errc() || ptr == epoch.data()) {
+    return;
   }
 
-  std::array<char, 4096> buffer{};
+  std::tm tm{};
+  time_t t = static_cast<time_t>(value);
+  localtime_r(&t, &tm);
 
-  while (fgets(buffer.data(), static_cast<int>(buffer.size()), fp) != nullptr) {
-    std::string line(buffer.data());
+  std::array<char, 64> buffer{};
+  std::size_t n = std::strftime(buffer.data(), buffer.size(),
+                                "%a %d %b %Y %I:%M:%S %p %Z", &tm);
+  out.assign(buffer.data(), n);
+}
 
-    if (!line.empty() && line.back() == '\n') {
-      line.pop_back();
+bool read_gzip(const std::string &path, std::string &out) {
+  out.clear();
+
+  gzFile gz = gzopen(path.c_str(), "rb");
+  if (!gz) {
+    return false;
+  }
+
+  std::array<char, 16384> buffer{};
+  int n;
+  while ((n = gzread(gz, buffer.data(),
+                     static_cast<unsigned>(buffer.size()))) > 0) {
+    out.append(buffer.data(), static_cast<std::size_t>(n));
+  }
+
+  gzclose(gz);
+  return n == 0;
+}
+
+void collect_backup(std::string_view text,
+                    std::unordered_set<std::string> &out) {
+  std::string_view key;
+  std::size_t pos = 0;
+
+  while (pos < text.size()) {
+    std::size_t eol = text.find('\n', pos);
+    if (eol == std::string_view::npos) {
+      eol = text.size();
     }
+    std::string_view line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+
     if (line.empty()) {
+      key = {};
+    } else if (line.size() > 2 && line.front() == '%' && line.back() == '%') {
+      key = line;
+    } else if (key == "%BACKUP%") {
+      out.emplace(line.substr(0, line.find('\t')));
+    }
+  }
+}
+
+std::string decode_mtree(std::string_view raw) {
+  std::string out;
+  out.reserve(raw.size());
+
+  for (std::size_t i = 0; i < raw.size(); ++i) {
+    if (raw[i] != '\\' || i + 1 >= raw.size()) {
+      out.push_back(raw[i]);
+    } else if (raw[i + 1] == '\\') {
+      out.push_back('\\');
+      ++i;
+    } else if (i + 3 < raw.size() && raw[i + 1] >= '0' &&
+               raw[i + 1] <= '7') {
+      int value = 0;
+      auto [ptr, ec] =
+          std::from_chars(raw.data() + i + 1, raw.data() + i + 4, value, 8);
+      if (ec != std::errc() || ptr != raw.data() + i + 4) {
+        out.push_back(raw[i]);
+        continue;
+      }
+      out.push_back(static_cast<char>(value));
+      i += 3;
+    } else {
+      out.push_back(raw[i]);
+    }
+  }
+  return out;
+}
+
+void apply_mtree_keyword(std::string_view keyword, FileEntry &entry) {
+  std::size_t eq = keyword.find('=');
+  if (eq == std::string_view::npos) {
+    return;
+  }
+  std::string_view key = keyword.substr(0, eq);
+  std::string_view value = keyword.substr(eq + 1);
+  const char *first = value.data();
+  const char *last = value.data() + value.size();
+
+  if (key == "type") {
+    if (value == "dir") {
+      entry.type = FileEntry::Type::Directory;
+    } else if (value == "link") {
+      entry.type = FileEntry::Type::Symlink;
+    } else {
+      entry.type = FileEntry::Type::File;
+    }
+  } else if (key == "mode") {
+    std::from_chars(first, last, entry.mode, 8);
+  } else if (key == "size") {
+    std::from_chars(first, last, entry.size);
+  } else if (key == "sha256digest") {
+    entry.sha256 = value;
+  } else if (key == "md5digest") {
+    entry.md5 = value;
+  } else if (key == "link") {
+    entry.link = decode_mtree(value);
+  }
+}
+
+void parse_mtree(std::string_view text,
+                 const std::unordered_set<std::string> &backup,
+                 std::vector<FileEntry> &out) {
+  FileEntry defaults;
+  std::size_t pos = 0;
+
+  while (pos < text.size()) {
+    std::size_t eol = text.find('\n', pos);
+    if (eol == std::string_view::npos) {
+      eol = text.size();
+    }
+    std::string_view line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+
+    std::size_t space = line.find(' ');
+    std::string_view head = line.substr(0, space);
+    std::string_view rest = space == std::string_view::npos
+                                ? std::string_view{}
+                                : line.substr(space + 1);
+
+    if (head == "/unset") {
+      defaults = FileEntry{};
       continue;
     }
 
-    std::size_t sep = line.find(' ');
-    if (sep == std::string::npos) {
+    FileEntry entry = defaults;
+    FileEntry &target = head == "/set" ? defaults : entry;
+    while (!rest.empty()) {
+      std::size_t next = rest.find(' ');
+      apply_mtree_keyword(rest.substr(0, next), target);
+      rest = next == std::string_view::npos ? std::string_view{}
+                                            : rest.substr(next + 1);
+    }
+    if (head == "/set") {
       continue;
     }
 
-    std::string name = line.substr(0, sep);
-    std::string version = line.substr(sep + 1);
+    entry.path = decode_mtree(head);
+    if (entry.path.rfind("./", 0) == 0) {
+      entry.path.erase(0, 2);
+    }
+    if (entry.path.empty() || entry.path == "." ||
+        (entry.path.front() == '.' &&
+         entry.path.find('/') == std::string::npos)) {
+      continue;
+    }
+    entry.backup = backup.find(entry.path) != backup.end();
+    out.push_back(std::move(entry));
+  }
+}
 
-    Package pkg;
-    pkg.name = std::move(name);
-    pkg.version = std::move(version);
-    pkg.description.clear();
-    pkg.repo.clear();
-    pkg.architecture.clear();
-    pkg.install_date.clear();
-    pkg.depends_on.clear();
-    pkg.required_by.clear();
+} // namespace
 
-    if (foreign.find(pkg.name) != foreign.end()) {
-      pkg.is_foreign = true;
-    } else {
-      pkg.is_foreign = false;
+PacmanPackageManager::PacmanPackageManager(std::string db_path)
+    : db_path_(std::move(db_path)) {}
+
+void PacmanPackageManager::visitInstalled(FieldMask fields,
+                                          const PackageVisitor &visit,
+                                          std::pmr::memory_resource *scratch) {
+  std::string local_dir = db_path_ + "/local";
+  DIR *dir = opendir(local_dir.c_str());
+  if (!dir) {
+    return;
+  }
+
+  std::pmr::vector<std::pmr::string> entries(scratch);
+  while (dirent *ent = readdir(dir)) {
+    std::string_view entry(ent->d_name);
+    std::string_view name, version;
+    if (entry.front() != '.' && split_entry_name(entry, name, version)) {
+      entries.emplace_back(entry);
     }
+  }
+  closedir(dir);
 
-    if (explicit_set.find(pkg.name) != explicit_set.end()) {
-      pkg.is_explicit = true;
-    } else {
-      pkg.is_explicit = false;
+  std::unordered_set<std::string> foreign;
+  if (fields & field::Foreign) {
+    foreign = get_foreign_packages();
+  }
+
+  const FieldMask desc_fields =
+      field::Description | field::Architecture | field::InstallDate |
+      field::InstalledSize | field::DependsOn | field::RequiredBy |
+      field::Explicit | field::Provides | field::Conflicts | field::Replaces;
+  const bool need_desc = (fields & desc_fields) != 0;
+  const bool keep_all = (fields & field::RequiredBy) != 0;
+  const std::size_t count = keep_all ? entries.size() : 1;
+
+  std::pmr::vector<std::pmr::string> descs(count, scratch);
+  std::pmr::vector<DescFields> parsed(count, scratch);
+  std::pmr::vector<Relations> relations(count, scratch);
+  std::pmr::string install_date(scratch);
+
+  auto load = [&](std::size_t i, std::size_t slot) {
+    parsed[slot] = DescFields{};
+    relations[slot].clear();
+    if (need_desc &&
+        read_file(local_dir + "/" + std::string(entries[i]) + "/desc",
+                  descs[slot])) {
+      parse_desc(descs[slot], parsed[slot], relations[slot]);
     }
+  };
 
-    packages.push_back(std::move(pkg));
+  auto emit = [&](std::size_t i, std::size_t slot,
+                  std::span<const std::string_view> required_by) {
+    PackageRecord record;
+    split_entry_name(entries[i], record.name, record.version);
+
+    const DescFields &desc = parsed[slot];
+    if (fields & field::Description) {
+      record.description = desc.description;
+    }
+    if (fields & field::Architecture) {
+      record.architecture = desc.architecture;
+    }
+    if (fields & field::InstallDate) {
+      format_install_date(desc.install_date, install_date);
+      record.install_date = install_date;
+    }
+    if (fields & field::InstalledSize) {
+      std::from_chars(desc.size.data(), desc.size.data() + desc.size.size(),
+                      record.installed_size);
+    }
+    if (fields & field::DependsOn) {
+      record.depends_on = relations[slot].depends_on;
+    }
+    if (fields & field::Provides) {
+      record.provides = relations[slot].provides;
+    }
+    if (fields & field::Conflicts) {
+      record.conflicts = relations[slot].conflicts;
+    }
+    if (fields & field::Replaces) {
+      record.replaces = relations[slot].replaces;
+    }
+    record.required_by = required_by;
+    if (fields & field::Foreign) {
+      record.is_foreign =
+          foreign.find(std::string(record.name)) != foreign.end();
+    }
+    if (fields & field::Explicit) {
+      record.is_explicit = desc.reason != "1";
+    }
+
+    visit(record);
+  };
+
+  if (!keep_all) {
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      load(i, 0);
+      emit(i, 0, {});
+    }
+    return;
   }
 
-  pclose(fp);
-  return packages;
+  std::pmr::unordered_map<std::string_view, std::size_t> by_name(scratch);
+  by_name.reserve(entries.size());
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    load(i, i);
+    std::string_view name, version;
+    split_entry_name(entries[i], name, version);
+    by_name.emplace(name, i);
+  }
+
+  std::pmr::vector<std::pmr::vector<std::string_view>> required_by(
+      entries.size(), scratch);
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    std::string_view name, version;
+    split_entry_name(entries[i], name, version);
+    for (auto dep : relations[i].depends_on) {
+      auto it = by_name.find(parse_constraint(dep).name);
+      if (it != by_name.end()) {
+        required_by[it->second].push_back(name);
+      }
+    }
+  }
+
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    emit(i, i, required_by[i]);
+  }
 }
 
 bool PacmanPackageManager::fillDetails(Package &pkg) {
-  if (!pkg.description.empty() || !pkg.repo.empty()) {
+  if (!pkg.repo.empty()) {
     return true;
   }
 
@@ -204,6 +523,9 @@ bool PacmanPackageManager::fillDetails(Package &pkg) {
   bool ok = false;
   std::string depends_raw;
   std::string required_by_raw;
+  std::string provides_raw;
+  std::string conflicts_raw;
+  std::string replaces_raw;
 
   while (fgets(buffer.data(), static_cast<int>(buffer.size()), fp) != nullptr) {
     std::string line(buffer.data());
@@ -244,6 +566,21 @@ bool PacmanPackageManager::fillDetails(Package &pkg) {
       if (colon != std::string::npos) {
         required_by_raw = trim(line.substr(colon + 1));
       }
+    } else if (starts_with(line, "Provides")) {
+      std::size_t colon = line.find(':');
+      if (colon != std::string::npos) {
+        provides_raw = trim(line.substr(colon + 1));
+      }
+    } else if (starts_with(line, "Conflicts With")) {
+      std::size_t colon = line.find(':');
+      if (colon != std::string::npos) {
+        conflicts_raw = trim(line.substr(colon + 1));
+      }
+    } else if (starts_with(line, "Replaces")) {
+      std::size_t colon = line.find(':');
+      if (colon != std::string::npos) {
+        replaces_raw = trim(line.substr(colon + 1));
+      }
     }
   }
 
@@ -251,8 +588,31 @@ bool PacmanPackageManager::fillDetails(Package &pkg) {
 
   pkg.depends_on = split_dep_list(depends_raw);
   pkg.required_by = split_dep_list(required_by_raw);
+  pkg.provides = split_dep_list(provides_raw);
+  pkg.conflicts = split_dep_list(conflicts_raw);
+  pkg.replaces = split_dep_list(replaces_raw);
 
   return ok;
 }
 
+bool PacmanPackageManager::listFiles(const Package &pkg,
+                                     std::vector<FileEntry> &out) {
+  out.clear();
+
+  std::string entry_dir = db_path_ + "/local/" + pkg.name + "-" + pkg.version;
+  std::string mtree;
+  if (!read_gzip(entry_dir + "/mtree", mtree)) {
+    return false;
+  }
+
+  std::pmr::string desc;
+  std::unordered_set<std::string> backup;
+  if (read_file(entry_dir + "/desc", desc)) {
+    collect_backup(desc, backup);
+  }
+
+  parse_mtree(mtree, backup, out);
+  return true;
+}
+
 } // namespace pkg
@@ -0,0 +1,175 @@
+#include "PipPackageManager.h"
+
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace pkg {
+
+namespace {
+
+std::string trim(const std::string &s) {
+  std::size_t start = 0;
+  while (start < s.size() &&
+         std::isspace(static_cast<unsigned char>(s[start]))) {
+    ++start;
+  }
+
+  std::size_t end = s.size();
+  while (end > start && std::isspace(static_cast<unsigned char>(s[end - 1]))) {
+    --end;
+  }
+
+  return s.substr(start, end - start);
+}
+
+std::vector<std::string> read_command_lines(const std::string &cmd) {
+  std::vector<std::string> lines;
+
+  FILE *fp = popen(cmd.c_str(), "r");
+  if (!fp) {
+    return lines;
+  }
+
+  std::array<char, 4096> buffer{};
+
+  while (fgets(buffer.data(), static_cast<int>(buffer.size()), fp) != nullptr) {
+    std::string line(buffer.data());
+    if (!line.empty() && line.back() == '\n') {
+      line.pop_back();
+    }
+    if (!line.empty()) {
+      lines.push_back(std::move(line));
+    }
+  }
+
+  pclose(fp);
+  return lines;
+}
+
+bool split_requirement(const std::string &line, std::string &name,
+                       std::string &version) {
+  std::size_t sep = line.find("==");
+  if (sep != std::string::npos) {
+    name = line.substr(0, sep);
+    version = line.substr(sep + 2);
+    return !name.empty();
+  }
+
+  sep = line.find(" @ ");
+  if (sep != std::string::npos) {
+    name = line.substr(0, sep);
+    version.clear();
+    return !name.empty();
+  }
+
+  return false;
+}
+
+std::string shell_quote(const std::string &arg) {
+  std::string quoted = "'";
+  for (char c : arg) {
+    if (c == '\'') {
+      quoted += "'\\''";
+    } else {
+      quoted += c;
+    }
+  }
+  quoted += '\'';
+  return quoted;
+}
+
+std::vector<std::string> split_comma_list(const std::string &raw) {
+  std::vector<std::string> out;
+  std::size_t start = 0;
+  while (start <= raw.size()) {
+    std::size_t comma = raw.find(',', start);
+    std::string item = trim(raw.substr(start, comma - start));
+    if (!item.empty()) {
+      out.push_back(std::move(item));
+    }
+    if (comma == std::string::npos) {
+      break;
+    }
+    start = comma + 1;
+  }
+  return out;
+}
+
+} // namespace
+
+PipPackageManager::PipPackageManager(std::string pip) : pip_(std::move(pip)) {}
+
+std::vector<Package> PipPackageManager::listInstalled() {
+  return listPackages(field::All);
+}
+
+std::vector<Package> PipPackageManager::listPackages(FieldMask fields) {
+  std::vector<Package> packages;
+
+  const std::string flags = " list --format=freeze --disable-pip-version-check";
+
+  std::unordered_set<std::string> top_level;
+  if (fields & field::Explicit) {
+    for (const auto &line :
+         read_command_lines(pip_ + flags + " --not-required 2>/dev/null")) {
+      std::string name, version;
+      if (split_requirement(line, name, version)) {
+        top_level.insert(std::move(name));
+      }
+    }
+  }
+
+  for (const auto &line : read_command_lines(pip_ + flags + " 2>/dev/null")) {
+    Package pkg;
+    if (!split_requirement(line, pkg.name, pkg.version)) {
+      continue;
+    }
+    pkg.is_explicit = top_level.find(pkg.name) != top_level.end();
+    packages.push_back(std::move(pkg));
+  }
+
+  return packages;
+}
+
+void PipPackageManager::visitInstalled(FieldMask fields,
+                                       const PackageVisitor &visit,
+                                       std::pmr::memory_resource *scratch) {
+  visit_packages(listPackages(fields), fields, visit, scratch);
+}
+
+bool PipPackageManager::fillDetails(Package &pkg) {
+  if (!pkg.description.empty()) {
+    return true;
+  }
+
+  bool ok = false;
+  for (const auto &line : read_command_lines(
+           pip_ + " show --disable-pip-version-check -- " +
+           shell_quote(pkg.name) + " 2>/dev/null")) {
+    std::size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+
+    std::string key = line.substr(0, colon);
+    std::string value = trim(line.substr(colon + 1));
+
+    if (key == "Summary") {
+      pkg.description = value;
+      ok = true;
+    } else if (key == "Requires") {
+      pkg.depends_on = split_comma_list(value);
+    } else if (key == "Required-by") {
+      pkg.required_by = split_comma_list(value);
+    }
+  }
+
+  return ok;
+}
+
+} // namespace pkg
@@ -0,0 +1,297 @@
+#include "Protocol.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace pkg {
+
+namespace proto {
+
+namespace {
+
+constexpr std::uint8_t flag_foreign = 1u << 0;
+constexpr std::uint8_t flag_explicit = 1u << 1;
+
+template <typename List> void write_list(Writer &w, const List &list) {
+  w.varint(list.size());
+  for (const auto &item : list) {
+    w.str(item);
+  }
+}
+
+bool read_list(Reader &r, std::pmr::vector<std::string_view> &out) {
+  out.clear();
+  std::uint64_t count = r.varint();
+  for (std::uint64_t i = 0; i < count && r.ok(); ++i) {
+    out.push_back(r.str());
+  }
+  return r.ok();
+}
+
+} // namespace
+
+void Writer::varint(std::uint64_t v) {
+  while (v >= 0x80) {
+    out_.push_back(static_cast<char>((v & 0x7f) | 0x80));
+    v >>= 7;
+  }
+  out_.push_back(static_cast<char>(v));
+}
+
+void Writer::str(std::string_view s) {
+  varint(s.size());
+  out_.append(s);
+}
+
+std::uint8_t Reader::u8() {
+  if (in_.empty()) {
+    ok_ = false;
+    return 0;
+  }
+  auto v = static_cast<std::uint8_t>(in_.front());
+  in_.remove_prefix(1);
+  return v;
+}
+
+std::uint64_t Reader::varint() {
+  std::uint64_t v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    std::uint8_t byte = u8();
+    if (!ok_) {
+      return 0;
+    }
+    v |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return v;
+    }
+  }
+  ok_ = false;
+  return 0;
+}
+
+std::string_view Reader::str() {
+  std::uint64_t size = varint();
+  if (!ok_ || size > in_.size()) {
+    ok_ = false;
+    return {};
+  }
+  std::string_view s = in_.substr(0, size);
+  in_.remove_prefix(size);
+  return s;
+}
+
+std::size_t begin_frame(std::string &out, Op op) {
+  std::size_t start = out.size();
+  out.append(4, '\0');
+  out.push_back(static_cast<char>(op));
+  return start;
+}
+
+void end_frame(std::string &out, std::size_t start) {
+  auto size = static_cast<std::uint32_t>(out.size() - start - 4);
+  for (int i = 0; i < 4; ++i) {
+    out[start + i] = static_cast<char>((size >> (8 * i)) & 0xff);
+  }
+}
+
+FrameStatus next_frame(std::string_view buffer, Op &op,
+                       std::string_view &payload, std::size_t &consumed) {
+  if (buffer.size() < 4) {
+    return FrameStatus::Incomplete;
+  }
+
+  std::uint32_t size = 0;
+  for (int i = 0; i < 4; ++i) {
+    size |= static_cast<std::uint32_t>(static_cast<unsigned char>(buffer[i]))
+            << (8 * i);
+  }
+  if (size == 0 || size > max_frame_size) {
+    return FrameStatus::Invalid;
+  }
+  if (buffer.size() - 4 < size) {
+    return FrameStatus::Incomplete;
+  }
+
+  op = static_cast<Op>(buffer[4]);
+  payload = buffer.substr(5, size - 1);
+  consumed = 4 + static_cast<std::size_t>(size);
+  return FrameStatus::Ready;
+}
+
+void encode_package(Writer &w, const Package &pkg, FieldMask fields) {
+  w.str(pkg.name);
+  w.str(pkg.source);
+  w.u8((pkg.is_foreign ? flag_foreign : 0) |
+       (pkg.is_explicit ? flag_explicit : 0));
+
+  if (fields & field::Version) {
+    w.str(pkg.version);
+  }
+  if (fields & field::Description) {
+    w.str(pkg.description);
+  }
+  if (fields & field::Repo) {
+    w.str(pkg.repo);
+  }
+  if (fields & field::Architecture) {
+    w.str(pkg.architecture);
+  }
+  if (fields & field::InstallDate) {
+    w.str(pkg.install_date);
+  }
+  if (fields & field::InstalledSize) {
+    w.varint(pkg.installed_size);
+  }
+  if (fields & field::DependsOn) {
+    write_list(w, pkg.depends_on);
+  }
+  if (fields & field::RequiredBy) {
+    write_list(w, pkg.required_by);
+  }
+  if (fields & field::Provides) {
+    write_list(w, pkg.provides);
+  }
+  if (fields & field::Conflicts) {
+    write_list(w, pkg.conflicts);
+  }
+  if (fields & field::Replaces) {
+    write_list(w, pkg.replaces);
+  }
+}
+
+bool decode_package(Reader &r, FieldMask fields, PackageRecord &record,
+                    RecordLists &lists) {
+  record = PackageRecord{};
+  record.name = r.str();
+  record.source = r.str();
+  std::uint8_t flags = r.u8();
+  record.is_foreign = flags & flag_foreign;
+  record.is_explicit = flags & flag_explicit;
+
+  if (fields & field::Version) {
+    record.version = r.str();
+  }
+  if (fields & field::Description) {
+    record.description = r.str();
+  }
+  if (fields & field::Repo) {
+    record.repo = r.str();
+  }
+  if (fields & field::Architecture) {
+    record.architecture = r.str();
+  }
+  if (fields & field::InstallDate) {
+    record.install_date = r.str();
+  }
+  if (fields & field::InstalledSize) {
+    record.installed_size = r.varint();
+  }
+  if ((fields & field::DependsOn) && read_list(r, lists.depends_on)) {
+    record.depends_on = lists.depends_on;
+  }
+  if ((fields & field::RequiredBy) && read_list(r, lists.required_by)) {
+    record.required_by = lists.required_by;
+  }
+  if ((fields & field::Provides) && read_list(r, lists.provides)) {
+    record.provides = lists.provides;
+  }
+  if ((fields & field::Conflicts) && read_list(r, lists.conflicts)) {
+    record.conflicts = lists.conflicts;
+  }
+  if ((fields & field::Replaces) && read_list(r, lists.replaces)) {
+    record.replaces = lists.replaces;
+  }
+  return r.ok();
+}
+
+std::string default_socket_path() {
+  const char *runtime = std::getenv("XDG_RUNTIME_DIR");
+  if (runtime && *runtime) {
+    return std::string(runtime) + "/package-explorer.sock";
+  }
+  return "/tmp/package-explorer-" + std::to_string(getuid()) + ".sock";
+}
+
+Connection::~Connection() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool Connection::open(const std::string &path) {
+  sockaddr_un addr{};
+  if (path.size() >= sizeof(addr.sun_path)) {
+    return false;
+  }
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+  fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) {
+    return false;
+  }
+  if (connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  return true;
+}
+
+bool Connection::call(Op op, std::string_view payload, Op &reply,
+                      std::string &reply_payload) {
+  if (fd_ < 0) {
+    return false;
+  }
+
+  std::string request;
+  std::size_t start = begin_frame(request, op);
+  request.append(payload);
+  end_frame(request, start);
+
+  std::size_t sent = 0;
+  while (sent < request.size()) {
+    ssize_t n = send(fd_, request.data() + sent, request.size() - sent,
+                     MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    sent += static_cast<std::size_t>(n);
+  }
+
+  char chunk[65536];
+  for (;;) {
+    std::string_view frame;
+    std::size_t consumed = 0;
+    FrameStatus status = next_frame(buffer_, reply, frame, consumed);
+    if (status == FrameStatus::Invalid) {
+      return false;
+    }
+    if (status == FrameStatus::Ready) {
+      reply_payload.assign(frame);
+      buffer_.erase(0, consumed);
+      return true;
+    }
+
+    ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    buffer_.append(chunk, static_cast<std::size_t>(n));
+  }
+}
+
+} // namespace proto
+
+} // namespace pkg
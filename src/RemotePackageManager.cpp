@@ -0,0 +1,96 @@
+#include "RemotePackageManager.h"
+
+#include <utility>
+
+namespace pkg {
+
+RemotePackageManager::RemotePackageManager(std::string socket_path)
+    : socket_path_(std::move(socket_path)) {}
+
+bool RemotePackageManager::connect() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return open_locked();
+}
+
+bool RemotePackageManager::open_locked() {
+  if (connection_) {
+    return true;
+  }
+  auto connection = std::make_unique<proto::Connection>();
+  if (!connection->open(socket_path_)) {
+    return false;
+  }
+  connection_ = std::move(connection);
+  return true;
+}
+
+bool RemotePackageManager::call(proto::Op op, std::string_view payload,
+                                proto::Op &reply,
+                                std::string &reply_payload) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    if (!open_locked()) {
+      return false;
+    }
+    if (connection_->call(op, payload, reply, reply_payload)) {
+      return reply == proto::Op::Packages;
+    }
+    connection_.reset();
+  }
+  return false;
+}
+
+void RemotePackageManager::visitInstalled(FieldMask fields,
+                                          const PackageVisitor &visit,
+                                          std::pmr::memory_resource *scratch) {
+  std::string request;
+  proto::Writer(request).varint(fields);
+
+  proto::Op reply;
+  std::string payload;
+  if (!call(proto::Op::List, request, reply, payload)) {
+    return;
+  }
+
+  proto::Reader r(payload);
+  auto sent_fields = static_cast<FieldMask>(r.varint());
+  std::uint64_t count = r.varint();
+
+  proto::RecordLists lists(scratch);
+  PackageRecord record;
+  for (std::uint64_t i = 0; i < count && r.ok(); ++i) {
+    if (proto::decode_package(r, sent_fields, record, lists)) {
+      visit(record);
+    }
+  }
+}
+
+bool RemotePackageManager::fillDetails(Package &pkg) {
+  std::string request;
+  proto::Writer w(request);
+  w.varint(field::All);
+  w.str(pkg.name);
+  w.str(pkg.source);
+
+  proto::Op reply;
+  std::string payload;
+  if (!call(proto::Op::Details, request, reply, payload)) {
+    return false;
+  }
+
+  proto::Reader r(payload);
+  auto sent_fields = static_cast<FieldMask>(r.varint());
+  if (r.varint() != 1) {
+    return false;
+  }
+
+  proto::RecordLists lists(std::pmr::get_default_resource());
+  PackageRecord record;
+  if (!proto::decode_package(r, sent_fields, record, lists)) {
+    return false;
+  }
+  pkg = to_package(record);
+  return true;
+}
+
+} // namespace pkg
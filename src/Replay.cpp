@@ -0,0 +1,233 @@
+#include "Replay.h"
+#include "MemStats.h"
+
+#include <ncurses.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+namespace pkg {
+
+namespace {
+
+constexpr int max_idle_polls = 1200;
+constexpr int max_repeat = 100000;
+
+struct Builtin {
+  std::string_view name;
+  std::string_view script;
+};
+
+constexpr Builtin builtins[] = {
+    {"scroll", "<down*300><up*300>"},
+    {"search", "/age-1<bs*5>e-42<bs*4>kg<bs*2><esc>"},
+    {"filter", "f<down*5>f<down*5>f<down*5>f<down*5>f"
+               "o<down*5>o<down*5>o<down*5>o<down*5>o"},
+    {"jump", "<down*40><1*40>"},
+    {"overlay", "hhsshhss"},
+    {"tree", "<down*20>t<down><right><down><right><down*10><right>"
+             "<down*30><up*30><left><left><left><up*5><esc>"},
+};
+
+int named_key(std::string_view name) {
+  if (name == "down") {
+    return KEY_DOWN;
+  } else if (name == "up") {
+    return KEY_UP;
+  } else if (name == "left") {
+    return KEY_LEFT;
+  } else if (name == "right") {
+    return KEY_RIGHT;
+  } else if (name == "pgup") {
+    return KEY_PPAGE;
+  } else if (name == "pgdn") {
+    return KEY_NPAGE;
+  } else if (name == "tab") {
+    return '\t';
+  } else if (name == "enter") {
+    return '\n';
+  } else if (name == "esc") {
+    return 27;
+  } else if (name == "bs") {
+    return KEY_BACKSPACE;
+  } else if (name == "space") {
+    return ' ';
+  } else if (name == "lt") {
+    return '<';
+  } else if (name.size() == 1) {
+    return static_cast<unsigned char>(name.front());
+  }
+  return -1;
+}
+
+} // namespace
+
+int TerminalKeys::next(int timeout_ms) {
+  timeout(timeout_ms);
+  return getch();
+}
+
+ScreenSink::ScreenSink() {
+  int fd = memfd_create("package-explorer-screen", MFD_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  stream_ = fdopen(fd, "w");
+  if (!stream_) {
+    close(fd);
+  }
+}
+
+ScreenSink::~ScreenSink() {
+  if (stream_) {
+    std::fclose(stream_);
+  }
+}
+
+std::uint64_t ScreenSink::drain() {
+  std::fflush(stream_);
+  int fd = fileno(stream_);
+  off_t written = lseek(fd, 0, SEEK_CUR);
+  if (written <= 0) {
+    return 0;
+  }
+  if (ftruncate(fd, 0) == 0) {
+    lseek(fd, 0, SEEK_SET);
+  }
+  return static_cast<std::uint64_t>(written);
+}
+
+int ScriptKeys::next(int timeout_ms) {
+  if (pending_) {
+    bytes_ += screen_.drain();
+    allocations_ += mem_allocations() - allocations_at_send_;
+    latencies_ms_.push_back(
+        std::chrono::duration<double, std::milli>(Clock::now() - sent_)
+            .count());
+    pending_ = false;
+  }
+
+  if (timeout_ms >= 0) {
+    if (polls_ < max_idle_polls) {
+      ++polls_;
+      std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+      return ERR;
+    }
+    stalled_ = true;
+  }
+  polls_ = 0;
+
+  if (pos_ >= keys_.size()) {
+    return 'q';
+  }
+  if (pos_ == 0) {
+    screen_.drain();
+  }
+  pending_ = true;
+  allocations_at_send_ = mem_allocations();
+  sent_ = Clock::now();
+  return keys_[pos_++];
+}
+
+ReplayReport ScriptKeys::report() const {
+  ReplayReport report;
+  report.keys = latencies_ms_.size();
+  report.stalled = stalled_;
+  if (latencies_ms_.empty()) {
+    return report;
+  }
+
+  std::vector<double> sorted = latencies_ms_;
+  std::sort(sorted.begin(), sorted.end());
+  report.p50_ms = sorted[sorted.size() / 2];
+  report.p99_ms = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+  report.max_ms = sorted.back();
+  report.bytes = bytes_;
+  report.allocations = allocations_;
+  return report;
+}
+
+bool parse_script(std::string_view text, std::vector<int> &keys) {
+  std::size_t pos = 0;
+  while (pos < text.size()) {
+    char ch = text[pos];
+    if (ch == '#') {
+      pos = text.find('\n', pos);
+      continue;
+    }
+    if (ch == '\n' || ch == '\r' || ch == '\t' || ch == ' ') {
+      ++pos;
+      continue;
+    }
+    if (ch != '<') {
+      keys.push_back(static_cast<unsigned char>(ch));
+      ++pos;
+      continue;
+    }
+
+    std::size_t close = text.find('>', pos);
+    if (close == std::string_view::npos) {
+      return false;
+    }
+    std::string_view token = text.substr(pos + 1, close - pos - 1);
+    pos = close + 1;
+
+    int repeat = 1;
+    std::size_t star = token.rfind('*');
+    if (star != std::string_view::npos && star > 0) {
+      auto [end, ec] = std::from_chars(token.data() + star + 1,
+                                       token.data() + token.size(), repeat);
+      if (ec != std::errc() || end != token.data() + token.size() ||
+          repeat < 0 || repeat > max_repeat) {
+        return false;
+      }
+      token = token.substr(0, star);
+    }
+
+    int key = named_key(token);
+    if (key < 0) {
+      return false;
+    }
+    keys.insert(keys.end(), static_cast<std::size_t>(repeat), key);
+  }
+  return true;
+}
+
+bool load_script(const std::string &name_or_path, std::vector<int> &keys) {
+  keys.clear();
+  if (name_or_path == "all") {
+    for (const auto &builtin : builtins) {
+      parse_script(builtin.script, keys);
+    }
+    return true;
+  }
+  for (const auto &builtin : builtins) {
+    if (builtin.name == name_or_path) {
+      return parse_script(builtin.script, keys);
+    }
+  }
+
+  std::ifstream in(name_or_path);
+  if (!in) {
+    return false;
+  }
+  std::string text((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  return parse_script(text, keys);
+}
+
+std::vector<std::string_view> builtin_scripts() {
+  std::vector<std::string_view> names;
+  for (const auto &builtin : builtins) {
+    names.push_back(builtin.name);
+  }
+  names.push_back("all");
+  return names;
+}
+
+} // namespace pkg
@@ -0,0 +1,30 @@
+#include "Search.h"
+
+#include <cctype>
+
+namespace pkg {
+
+namespace {
+
+char lower(char c) {
+  return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+} // namespace
+
+bool fuzzy_match(std::string_view pattern, std::string_view text) {
+  std::size_t ti = 0;
+  for (char pc : pattern) {
+    pc = lower(pc);
+    while (ti < text.size() && lower(text[ti]) != pc) {
+      ++ti;
+    }
+    if (ti == text.size()) {
+      return false;
+    }
+    ++ti;
+  }
+  return true;
+}
+
+} // namespace pkg
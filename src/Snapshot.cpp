@@ -0,0 +1,385 @@
+#include "Snapshot.h"
+#include "StringMap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pkg {
+
+namespace {
+
+constexpr char snapshot_magic[8] = {'P', 'K', 'X', 'S', 'N', 'A', 'P', '1'};
+constexpr std::uint32_t snapshot_format = 2;
+
+struct Header {
+  char magic[8];
+  std::uint32_t format;
+  std::uint32_t count;
+  std::uint64_t host_offset;
+  std::uint64_t host_size;
+  std::uint64_t name_index;
+  std::uint64_t name_data;
+  std::uint64_t version_index;
+  std::uint64_t version_data;
+  std::uint64_t source_index;
+  std::uint64_t source_data;
+  std::uint64_t architecture_index;
+  std::uint64_t architecture_data;
+  std::uint64_t flags;
+  std::uint64_t file_size;
+};
+
+void pad_to_8(std::string &buf) {
+  while (buf.size() % 8 != 0) {
+    buf.push_back('\0');
+  }
+}
+
+template <typename Get>
+void append_column(std::string &buf, const std::vector<const Package *> &rows,
+                   Get get, std::uint64_t &index_at, std::uint64_t &data_at) {
+  pad_to_8(buf);
+  index_at = buf.size();
+
+  std::uint32_t offset = 0;
+  buf.append(reinterpret_cast<const char *>(&offset), sizeof(offset));
+  for (const auto *pkg : rows) {
+    offset += static_cast<std::uint32_t>(get(*pkg).size());
+    buf.append(reinterpret_cast<const char *>(&offset), sizeof(offset));
+  }
+
+  pad_to_8(buf);
+  data_at = buf.size();
+  for (const auto *pkg : rows) {
+    buf += get(*pkg);
+  }
+}
+
+bool fits(std::uint64_t offset, std::uint64_t length, std::uint64_t size) {
+  return offset <= size && length <= size - offset;
+}
+
+struct RowKey {
+  std::string_view name;
+  std::string_view source;
+  std::string_view architecture;
+};
+
+RowKey row_key(const Package &pkg) {
+  return {pkg.name, pkg.source, pkg.architecture};
+}
+
+RowKey row_key(const Snapshot &snap, std::size_t i) {
+  return {snap.name(i), snap.source(i), snap.architecture(i)};
+}
+
+bool row_less(const RowKey &a, const RowKey &b) {
+  if (a.name != b.name) {
+    return a.name < b.name;
+  }
+  if (a.source != b.source) {
+    return a.source < b.source;
+  }
+  return a.architecture < b.architecture;
+}
+
+unsigned worker_count(unsigned threads, std::size_t jobs) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  return static_cast<unsigned>(
+      std::min<std::size_t>(threads, std::max<std::size_t>(jobs, 1)));
+}
+
+template <typename Fn>
+void parallel_for_each_snapshot(const std::vector<std::string> &paths,
+                                unsigned threads, Fn &&fn) {
+  std::atomic<std::size_t> next{0};
+  unsigned workers = worker_count(threads, paths.size());
+
+  std::vector<std::thread> pool;
+  pool.reserve(workers);
+  for (unsigned w = 0; w < workers; ++w) {
+    pool.emplace_back([&, w] {
+      std::size_t i;
+      while ((i = next.fetch_add(1)) < paths.size()) {
+        Snapshot snap(paths[i]);
+        if (snap.ok()) {
+          fn(w, snap);
+        } else {
+          std::fprintf(stderr, "skipping unreadable snapshot %s\n",
+                       paths[i].c_str());
+        }
+      }
+    });
+  }
+
+  for (auto &thread : pool) {
+    thread.join();
+  }
+}
+
+} // namespace
+
+bool write_snapshot(const std::string &path,
+                    const std::vector<Package> &packages,
+                    const std::string &host) {
+  std::vector<const Package *> rows;
+  rows.reserve(packages.size());
+  for (const auto &pkg : packages) {
+    rows.push_back(&pkg);
+  }
+  std::sort(rows.begin(), rows.end(), [](const Package *a, const Package *b) {
+    return row_less(row_key(*a), row_key(*b));
+  });
+
+  Header header{};
+  std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+  header.format = snapshot_format;
+  header.count = static_cast<std::uint32_t>(rows.size());
+
+  std::string buf(sizeof(Header), '\0');
+  append_column(
+      buf, rows, [](const Package &p) -> const std::string & { return p.name; },
+      header.name_index, header.name_data);
+  append_column(
+      buf, rows,
+      [](const Package &p) -> const std::string & { return p.version; },
+      header.version_index, header.version_data);
+  append_column(
+      buf, rows,
+      [](const Package &p) -> const std::string & { return p.source; },
+      header.source_index, header.source_data);
+  append_column(
+      buf, rows,
+      [](const Package &p) -> const std::string & { return p.architecture; },
+      header.architecture_index, header.architecture_data);
+
+  pad_to_8(buf);
+  header.flags = buf.size();
+  for (const auto *pkg : rows) {
+    std::uint8_t flags = 0;
+    if (pkg->is_explicit) {
+      flags |= snapshot_flag::Explicit;
+    }
+    if (pkg->is_foreign) {
+      flags |= snapshot_flag::Foreign;
+    }
+    buf.push_back(static_cast<char>(flags));
+  }
+
+  header.host_offset = buf.size();
+  header.host_size = host.size();
+  buf += host;
+  header.file_size = buf.size();
+
+  std::memcpy(buf.data(), &header, sizeof(header));
+
+  std::string tmp = path + ".tmp";
+  FILE *fp = std::fopen(tmp.c_str(), "wb");
+  if (!fp) {
+    return false;
+  }
+  bool ok = std::fwrite(buf.data(), 1, buf.size(), fp) == buf.size();
+  ok = std::fclose(fp) == 0 && ok;
+  if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+Snapshot::Snapshot(const std::string &path) : file_(path) {
+  if (!file_.ok()) {
+    return;
+  }
+
+  std::string_view bytes = file_.view();
+  if (bytes.size() < sizeof(Header)) {
+    return;
+  }
+
+  Header header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  if (std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0 ||
+      header.format != snapshot_format || header.file_size != bytes.size()) {
+    return;
+  }
+
+  const std::uint64_t size = bytes.size();
+  const std::uint64_t count = header.count;
+  if (count > size / sizeof(std::uint32_t) - 1) {
+    return;
+  }
+  const std::uint64_t index_bytes = (count + 1) * sizeof(std::uint32_t);
+
+  auto column = [&](std::uint64_t index_at, std::uint64_t data_at,
+                    Column &out) {
+    if (index_at % 8 != 0 || !fits(index_at, index_bytes, size) ||
+        data_at > size) {
+      return false;
+    }
+    out.offsets =
+        reinterpret_cast<const std::uint32_t *>(bytes.data() + index_at);
+    out.data = bytes.data() + data_at;
+
+    for (std::uint64_t i = 0; i < count; ++i) {
+      if (out.offsets[i] > out.offsets[i + 1]) {
+        return false;
+      }
+    }
+    return out.offsets[0] == 0 && fits(data_at, out.offsets[count], size);
+  };
+
+  if (!column(header.name_index, header.name_data, names_) ||
+      !column(header.version_index, header.version_data, versions_) ||
+      !column(header.source_index, header.source_data, sources_) ||
+      !column(header.architecture_index, header.architecture_data,
+              architectures_) ||
+      !fits(header.flags, count, size) ||
+      !fits(header.host_offset, header.host_size, size)) {
+    return;
+  }
+
+  flags_ = reinterpret_cast<const std::uint8_t *>(bytes.data() + header.flags);
+  host_ = bytes.substr(header.host_offset, header.host_size);
+  count_ = header.count;
+  ok_ = true;
+}
+
+std::string_view Snapshot::name(std::size_t i) const { return names_.at(i); }
+
+std::string_view Snapshot::version(std::size_t i) const {
+  return versions_.at(i);
+}
+
+std::string_view Snapshot::source(std::size_t i) const {
+  return sources_.at(i);
+}
+
+std::string_view Snapshot::architecture(std::size_t i) const {
+  return architectures_.at(i);
+}
+
+std::size_t Snapshot::find(std::string_view name) const {
+  std::size_t lo = 0;
+  std::size_t hi = count_;
+  while (lo < hi) {
+    std::size_t mid = lo + (hi - lo) / 2;
+    if (names_.at(mid) < name) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo < count_ && names_.at(lo) == name ? lo : count_;
+}
+
+std::vector<SnapshotDiff> diff_snapshots(const Snapshot &from,
+                                         const Snapshot &to) {
+  std::vector<SnapshotDiff> out;
+
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < from.size() || j < to.size()) {
+    if (j >= to.size() ||
+        (i < from.size() && row_less(row_key(from, i), row_key(to, j)))) {
+      out.push_back({SnapshotDiff::Kind::Removed, from.name(i), from.source(i),
+                     from.architecture(i), from.version(i), {}});
+      ++i;
+    } else if (i >= from.size() || row_less(row_key(to, j), row_key(from, i))) {
+      out.push_back({SnapshotDiff::Kind::Added, to.name(j), to.source(j),
+                     to.architecture(j), {}, to.version(j)});
+      ++j;
+    } else {
+      if (from.version(i) != to.version(j)) {
+        out.push_back({SnapshotDiff::Kind::Changed, from.name(i),
+                       from.source(i), from.architecture(i), from.version(i),
+                       to.version(j)});
+      }
+      ++i;
+      ++j;
+    }
+  }
+
+  return out;
+}
+
+std::vector<VersionHistogram>
+aggregate_versions(const std::vector<std::string> &paths, unsigned threads) {
+  using Counts = StringMap<StringMap<std::uint32_t>>;
+
+  std::vector<Counts> partial(worker_count(threads, paths.size()));
+  parallel_for_each_snapshot(
+      paths, threads, [&](unsigned worker, const Snapshot &snap) {
+        Counts &counts = partial[worker];
+        for (std::size_t i = 0; i < snap.size(); ++i) {
+          auto &versions = lookup_or_insert(counts, snap.name(i));
+          lookup_or_insert(versions, snap.version(i))++;
+        }
+      });
+
+  Counts &merged = partial.front();
+  for (std::size_t w = 1; w < partial.size(); ++w) {
+    for (auto &[name, versions] : partial[w]) {
+      auto &target = lookup_or_insert(merged, name);
+      for (auto &[version, n] : versions) {
+        lookup_or_insert(target, version) += n;
+      }
+    }
+    partial[w].clear();
+  }
+
+  std::vector<VersionHistogram> out;
+  out.reserve(merged.size());
+  for (auto &[name, versions] : merged) {
+    VersionHistogram hist;
+    hist.name = name;
+    hist.versions.assign(versions.begin(), versions.end());
+    std::sort(hist.versions.begin(), hist.versions.end(),
+              [](const auto &a, const auto &b) {
+                return vercmp(a.first, b.first) < 0;
+              });
+    out.push_back(std::move(hist));
+  }
+  std::sort(out.begin(), out.end(),
+            [](const auto &a, const auto &b) { return a.name < b.name; });
+  return out;
+}
+
+std::vector<std::pair<std::string, std::string>>
+hosts_matching(const std::vector<std::string> &paths,
+               const Constraint &constraint, unsigned threads) {
+  using Matches = std::vector<std::pair<std::string, std::string>>;
+
+  std::vector<Matches> partial(worker_count(threads, paths.size()));
+  parallel_for_each_snapshot(
+      paths, threads, [&](unsigned worker, const Snapshot &snap) {
+        for (std::size_t i = snap.find(constraint.name);
+             i < snap.size() && snap.name(i) == constraint.name; ++i) {
+          if (satisfies(snap.version(i), constraint.op, constraint.version,
+                        scheme_for_source(snap.source(i)))) {
+            partial[worker].emplace_back(std::string(snap.host()),
+                                         std::string(snap.version(i)));
+          }
+        }
+      });
+
+  Matches out;
+  for (auto &matches : partial) {
+    out.insert(out.end(), std::make_move_iterator(matches.begin()),
+               std::make_move_iterator(matches.end()));
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+} // namespace pkg
@@ -0,0 +1,500 @@
+#include "TextStore.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstdlib>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace pkg {
+
+namespace {
+
+constexpr int compression_level = 9;
+constexpr int min_window_bits = 9;
+constexpr int max_window_bits = 15;
+constexpr std::size_t min_training_bytes = 8 * 1024;
+constexpr std::size_t min_training_samples = 16;
+constexpr std::size_t max_dictionary_bytes = 16 * 1024;
+constexpr std::size_t min_dictionary_bytes = 1024;
+constexpr std::size_t kmer_bytes = 6;
+constexpr std::size_t segment_bytes = 32;
+
+unsigned char lower(char ch) {
+  return static_cast<unsigned char>(
+      std::tolower(static_cast<unsigned char>(ch)));
+}
+
+template <std::size_t N>
+void add_trigrams(std::array<std::uint64_t, N> &signature,
+                  std::string_view text) {
+  constexpr int shift = 32 - std::countr_zero(N * 64);
+  for (std::size_t i = 2; i < text.size(); ++i) {
+    std::uint32_t trigram = std::uint32_t{lower(text[i - 2])} << 16 |
+                            std::uint32_t{lower(text[i - 1])} << 8 |
+                            lower(text[i]);
+    std::uint32_t bit = (trigram * 2654435761u) >> shift;
+    signature[bit / 64] |= std::uint64_t{1} << (bit % 64);
+  }
+}
+
+template <std::size_t N>
+bool covers(const std::array<std::uint64_t, N> &have,
+            const std::array<std::uint64_t, N> &want) {
+  for (std::size_t i = 0; i < have.size(); ++i) {
+    if ((have[i] & want[i]) != want[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool contains(std::string_view text, std::string_view lowered) {
+  auto it = std::search(text.begin(), text.end(), lowered.begin(),
+                        lowered.end(), [](char a, char b) {
+                          return lower(a) == static_cast<unsigned char>(b);
+                        });
+  return it != text.end() || lowered.empty();
+}
+
+std::uint64_t kmer_at(std::string_view text, std::size_t pos) {
+  std::uint64_t key = 0;
+  for (std::size_t i = 0; i < kmer_bytes; ++i) {
+    key = key << 8 | static_cast<unsigned char>(text[pos + i]);
+  }
+  return key;
+}
+
+struct Candidate {
+  std::uint64_t score;
+  std::string_view segment;
+
+  bool operator<(const Candidate &other) const { return score < other.score; }
+};
+
+std::string train_dictionary(const std::vector<std::string_view> &texts) {
+  std::size_t total = 0;
+  std::size_t samples = 0;
+  for (std::string_view text : texts) {
+    if (!text.empty()) {
+      total += text.size();
+      ++samples;
+    }
+  }
+  if (total < min_training_bytes || samples < min_training_samples) {
+    return {};
+  }
+  std::size_t capacity =
+      std::clamp(total / 16, min_dictionary_bytes, max_dictionary_bytes);
+
+  std::unordered_map<std::uint64_t, std::uint32_t> frequency;
+  std::unordered_set<std::uint64_t> seen;
+  for (std::string_view text : texts) {
+    seen.clear();
+    for (std::size_t pos = 0; pos + kmer_bytes <= text.size(); ++pos) {
+      std::uint64_t key = kmer_at(text, pos);
+      if (seen.insert(key).second) {
+        ++frequency[key];
+      }
+    }
+  }
+
+  auto score = [&](std::string_view segment) {
+    std::uint64_t sum = 0;
+    for (std::size_t pos = 0; pos + kmer_bytes <= segment.size(); ++pos) {
+      std::uint32_t count = frequency[kmer_at(segment, pos)];
+      sum += count > 1 ? count - 1 : 0;
+    }
+    return sum;
+  };
+
+  std::priority_queue<Candidate> queue;
+  for (std::string_view text : texts) {
+    for (std::size_t pos = 0; pos < text.size(); pos += segment_bytes) {
+      std::string_view segment = text.substr(pos, segment_bytes);
+      std::uint64_t value = score(segment);
+      if (value > 0) {
+        queue.push({value, segment});
+      }
+    }
+  }
+
+  std::vector<std::string_view> picked;
+  std::size_t size = 0;
+  while (!queue.empty() && size < capacity) {
+    Candidate top = queue.top();
+    queue.pop();
+    std::uint64_t value = score(top.segment);
+    if (value == 0) {
+      continue;
+    }
+    if (value < top.score && !queue.empty() && value < queue.top().score) {
+      queue.push({value, top.segment});
+      continue;
+    }
+    picked.push_back(top.segment);
+    size += top.segment.size();
+    for (std::size_t pos = 0; pos + kmer_bytes <= top.segment.size();
+         ++pos) {
+      frequency[kmer_at(top.segment, pos)] = 0;
+    }
+  }
+
+  std::string dictionary;
+  dictionary.reserve(size);
+  for (auto it = picked.rbegin(); it != picked.rend(); ++it) {
+    dictionary.append(*it);
+  }
+  if (dictionary.size() > capacity) {
+    dictionary.erase(0, dictionary.size() - capacity);
+  }
+  return dictionary;
+}
+
+int window_for(std::size_t bytes) {
+  int bits = min_window_bits;
+  while (bits < max_window_bits && (std::size_t{1} << bits) < bytes) {
+    ++bits;
+  }
+  return bits;
+}
+
+bool compress_block(z_stream &stream, std::string_view dictionary,
+                    std::string_view raw, std::string &out) {
+  if (deflateReset(&stream) != Z_OK) {
+    return false;
+  }
+  if (!dictionary.empty() &&
+      deflateSetDictionary(
+          &stream, reinterpret_cast<const Bytef *>(dictionary.data()),
+          static_cast<uInt>(dictionary.size())) != Z_OK) {
+    return false;
+  }
+  out.resize(deflateBound(&stream, raw.size()));
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(raw.data()));
+  stream.avail_in = static_cast<uInt>(raw.size());
+  stream.next_out = reinterpret_cast<Bytef *>(out.data());
+  stream.avail_out = static_cast<uInt>(out.size());
+  if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+    return false;
+  }
+  out.resize(stream.total_out);
+  return true;
+}
+
+voidpf counted_alloc(voidpf opaque, uInt items, uInt size) {
+  *static_cast<std::uint64_t *>(opaque) += std::uint64_t{items} * size;
+  return std::calloc(items, size);
+}
+
+void counted_free(voidpf, voidpf address) { std::free(address); }
+
+} // namespace
+
+TextStore::TextStore(std::size_t block_entries, std::size_t cache_blocks)
+    : block_entries_(std::max<std::size_t>(block_entries, 1)),
+      cache_(std::max<std::size_t>(cache_blocks, 1)) {}
+
+TextStore::~TextStore() { clear(); }
+
+void TextStore::clear() {
+  if (inflater_) {
+    inflateEnd(inflater_);
+    delete inflater_;
+    inflater_ = nullptr;
+  }
+  inflater_bytes_ = 0;
+  entries_ = 0;
+  raw_bytes_ = 0;
+  std::vector<Block>().swap(blocks_);
+  std::vector<std::uint32_t>().swap(offsets_);
+  std::string().swap(data_);
+  std::string().swap(dictionary_);
+  std::string().swap(scratch_);
+  for (auto &entry : cache_) {
+    entry = CachedBlock();
+  }
+  tick_ = 0;
+  hits_ = 0;
+  misses_ = 0;
+}
+
+void TextStore::set_cache_blocks(std::size_t blocks) {
+  cache_.resize(std::max<std::size_t>(blocks, 1));
+}
+
+bool TextStore::build(const std::vector<std::string_view> &texts) {
+  clear();
+
+  dictionary_ = train_dictionary(texts);
+  std::size_t largest = 0;
+  for (std::size_t first = 0; first < texts.size(); first += block_entries_) {
+    std::size_t raw = 0;
+    for (std::size_t i = first;
+         i < std::min(first + block_entries_, texts.size()); ++i) {
+      raw += texts[i].size();
+    }
+    largest = std::max(largest, raw);
+  }
+  window_bits_ = window_for(dictionary_.size() + largest);
+
+  z_stream deflater{};
+  if (deflateInit2(&deflater, compression_level, Z_DEFLATED, -window_bits_, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+
+  bool ok = true;
+  std::string raw;
+  std::string packed;
+  offsets_.reserve(texts.size());
+  blocks_.reserve((texts.size() + block_entries_ - 1) / block_entries_);
+  for (std::size_t first = 0; first < texts.size(); first += block_entries_) {
+    std::size_t last = std::min(first + block_entries_, texts.size());
+    Block block;
+    raw.clear();
+    for (std::size_t i = first; i < last; ++i) {
+      offsets_.push_back(static_cast<std::uint32_t>(raw.size()));
+      raw.append(texts[i]);
+      add_trigrams(block.trigrams, texts[i]);
+    }
+
+    if (!compress_block(deflater, dictionary_, raw, packed)) {
+      ok = false;
+      break;
+    }
+    block.offset = data_.size();
+    block.compressed = static_cast<std::uint32_t>(packed.size());
+    block.raw = static_cast<std::uint32_t>(raw.size());
+    blocks_.push_back(block);
+    data_.append(packed);
+    raw_bytes_ += raw.size();
+  }
+  deflateEnd(&deflater);
+
+  if (ok) {
+    inflater_ = new z_stream{};
+    inflater_->zalloc = counted_alloc;
+    inflater_->zfree = counted_free;
+    inflater_->opaque = &inflater_bytes_;
+    if (inflateInit2(inflater_, -window_bits_) != Z_OK) {
+      delete inflater_;
+      inflater_ = nullptr;
+      ok = false;
+    }
+  }
+  if (!ok) {
+    clear();
+    return false;
+  }
+
+  data_.shrink_to_fit();
+  entries_ = texts.size();
+  return true;
+}
+
+bool TextStore::get(std::size_t id, std::string &out) {
+  out.clear();
+  if (id >= entries_) {
+    return false;
+  }
+  const std::string *text = cached(id / block_entries_);
+  if (!text) {
+    return false;
+  }
+  std::uint32_t begin = offsets_[id];
+  out.assign(*text, begin, entry_end(id) - begin);
+  return true;
+}
+
+bool TextStore::set(std::size_t id, std::string_view text) {
+  if (id >= entries_) {
+    return false;
+  }
+  std::size_t block = id / block_entries_;
+  const std::string *current = cached(block);
+  if (!current) {
+    return false;
+  }
+
+  std::uint32_t begin = offsets_[id];
+  std::uint32_t end = entry_end(id);
+  std::string raw = *current;
+  raw.replace(begin, end - begin, text);
+
+  std::string packed;
+  if (!encode(raw, packed)) {
+    return false;
+  }
+
+  Block &b = blocks_[block];
+  data_.replace(b.offset, b.compressed, packed);
+  for (std::size_t next = block + 1; next < blocks_.size(); ++next) {
+    blocks_[next].offset = blocks_[next].offset - b.compressed + packed.size();
+  }
+
+  std::size_t first = block * block_entries_;
+  std::size_t last = std::min(first + block_entries_, entries_);
+  for (std::size_t next = id + 1; next < last; ++next) {
+    offsets_[next] = offsets_[next] - (end - begin) +
+                     static_cast<std::uint32_t>(text.size());
+  }
+  raw_bytes_ = raw_bytes_ - b.raw + raw.size();
+  b.compressed = static_cast<std::uint32_t>(packed.size());
+  b.raw = static_cast<std::uint32_t>(raw.size());
+  b.trigrams = {};
+  for (std::size_t entry = first; entry < last; ++entry) {
+    std::uint32_t from = offsets_[entry];
+    add_trigrams(b.trigrams, std::string_view(raw).substr(
+                                 from, entry_end(entry) - from));
+  }
+
+  for (auto &entry : cache_) {
+    if (entry.block == block) {
+      entry.text.swap(raw);
+    }
+  }
+  return true;
+}
+
+std::size_t TextStore::search(std::string_view needle,
+                              std::vector<std::size_t> &matches) {
+  std::string lowered;
+  lowered.reserve(needle.size());
+  for (char ch : needle) {
+    lowered.push_back(static_cast<char>(lower(ch)));
+  }
+  Signature wanted{};
+  add_trigrams(wanted, lowered);
+
+  std::size_t scanned = 0;
+  for (std::size_t b = 0; b < blocks_.size(); ++b) {
+    if (!covers(blocks_[b].trigrams, wanted)) {
+      continue;
+    }
+    const std::string *text = peek(b);
+    if (!text) {
+      if (!decode(b, scratch_)) {
+        continue;
+      }
+      text = &scratch_;
+    }
+    ++scanned;
+
+    std::size_t first = b * block_entries_;
+    std::size_t last = std::min(first + block_entries_, entries_);
+    for (std::size_t id = first; id < last; ++id) {
+      std::string_view entry(text->data() + offsets_[id],
+                             entry_end(id) - offsets_[id]);
+      if (contains(entry, lowered)) {
+        matches.push_back(id);
+      }
+    }
+  }
+  return scanned;
+}
+
+TextStoreStats TextStore::stats() const {
+  TextStoreStats stats;
+  stats.entries = entries_;
+  stats.blocks = blocks_.size();
+  stats.raw_bytes = raw_bytes_;
+  stats.compressed_bytes = data_.capacity();
+  stats.dictionary_bytes = dictionary_.capacity();
+  stats.index_bytes = blocks_.capacity() * sizeof(Block) +
+                      offsets_.capacity() * sizeof(std::uint32_t) +
+                      cache_.capacity() * sizeof(CachedBlock);
+  stats.cache_bytes = scratch_.capacity() + inflater_bytes_ +
+                      (inflater_ ? sizeof(z_stream) : 0);
+  for (const auto &entry : cache_) {
+    stats.cache_bytes += entry.text.capacity();
+  }
+  stats.cache_hits = hits_;
+  stats.cache_misses = misses_;
+  return stats;
+}
+
+bool TextStore::decode(std::size_t block, std::string &out) {
+  const Block &b = blocks_[block];
+  out.resize(b.raw);
+  if (b.raw == 0) {
+    return true;
+  }
+  if (inflateReset(inflater_) != Z_OK) {
+    out.clear();
+    return false;
+  }
+  if (!dictionary_.empty() &&
+      inflateSetDictionary(
+          inflater_, reinterpret_cast<const Bytef *>(dictionary_.data()),
+          static_cast<uInt>(dictionary_.size())) != Z_OK) {
+    out.clear();
+    return false;
+  }
+  inflater_->next_in = reinterpret_cast<Bytef *>(data_.data() + b.offset);
+  inflater_->avail_in = b.compressed;
+  inflater_->next_out = reinterpret_cast<Bytef *>(out.data());
+  inflater_->avail_out = b.raw;
+  if (inflate(inflater_, Z_FINISH) != Z_STREAM_END ||
+      inflater_->total_out != b.raw) {
+    out.clear();
+    return false;
+  }
+  return true;
+}
+
+bool TextStore::encode(std::string_view raw, std::string &out) const {
+  z_stream deflater{};
+  if (deflateInit2(&deflater, compression_level, Z_DEFLATED, -window_bits_, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  bool ok = compress_block(deflater, dictionary_, raw, out);
+  deflateEnd(&deflater);
+  return ok;
+}
+
+const std::string *TextStore::cached(std::size_t block) {
+  CachedBlock *victim = &cache_.front();
+  for (auto &entry : cache_) {
+    if (entry.block == block) {
+      entry.used = ++tick_;
+      ++hits_;
+      return &entry.text;
+    }
+    if (entry.used < victim->used) {
+      victim = &entry;
+    }
+  }
+
+  ++misses_;
+  victim->block = static_cast<std::size_t>(-1);
+  if (!decode(block, victim->text)) {
+    return nullptr;
+  }
+  victim->block = block;
+  victim->used = ++tick_;
+  return &victim->text;
+}
+
+const std::string *TextStore::peek(std::size_t block) const {
+  for (const auto &entry : cache_) {
+    if (entry.block == block) {
+      return &entry.text;
+    }
+  }
+  return nullptr;
+}
+
+std::uint32_t TextStore::entry_end(std::size_t id) const {
+  if (id + 1 < entries_ && (id + 1) % block_entries_ != 0) {
+    return offsets_[id + 1];
+  }
+  return blocks_[id / block_entries_].raw;
+}
+
+} // namespace pkg
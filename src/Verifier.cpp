@@ -0,0 +1,334 @@
+#include "Verifier.h"
+
+#include <fcntl.h>
+#include <openssl/evp.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace pkg {
+
+namespace {
+
+constexpr std::size_t hash_buffer_size = 1u << 20;
+
+struct Job {
+  std::uint32_t package;
+  std::int32_t file;
+};
+
+class WorkStealingPool {
+public:
+  explicit WorkStealingPool(unsigned workers) : queues_(workers) {}
+
+  unsigned size() const { return static_cast<unsigned>(queues_.size()); }
+
+  void push(unsigned worker, Job job) {
+    pending_.fetch_add(1);
+    {
+      std::lock_guard<std::mutex> lock(queues_[worker].mutex);
+      queues_[worker].jobs.push_back(job);
+    }
+    queued_.fetch_add(1);
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    idle_.notify_one();
+  }
+
+  template <typename Fn> void run(Fn &&fn) {
+    std::vector<std::thread> threads;
+    threads.reserve(queues_.size());
+    for (unsigned w = 1; w < queues_.size(); ++w) {
+      threads.emplace_back([this, w, &fn] { work(w, fn); });
+    }
+    work(0, fn);
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  bool pop(unsigned worker, Job &job) {
+    std::lock_guard<std::mutex> lock(queues_[worker].mutex);
+    if (queues_[worker].jobs.empty()) {
+      return false;
+    }
+    job = queues_[worker].jobs.back();
+    queues_[worker].jobs.pop_back();
+    return true;
+  }
+
+  bool steal(unsigned thief, Job &job) {
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+      Queue &victim = queues_[(thief + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.jobs.empty()) {
+        job = victim.jobs.front();
+        victim.jobs.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template <typename Fn> void work(unsigned worker, Fn &fn) {
+    Job job;
+    while (pending_.load() > 0) {
+      if (pop(worker, job) || steal(worker, job)) {
+        queued_.fetch_sub(1);
+        fn(worker, job);
+        if (pending_.fetch_sub(1) == 1) {
+          std::lock_guard<std::mutex> lock(idle_mutex_);
+          idle_.notify_all();
+        }
+      } else {
+        std::unique_lock<std::mutex> lock(idle_mutex_);
+        idle_.wait(lock, [this] {
+          return queued_.load() > 0 || pending_.load() == 0;
+        });
+      }
+    }
+  }
+
+  std::vector<Queue> queues_;
+  std::atomic<std::size_t> pending_{0};
+  std::atomic<std::size_t> queued_{0};
+  std::mutex idle_mutex_;
+  std::condition_variable idle_;
+};
+
+std::string to_hex(const unsigned char *data, unsigned size) {
+  static const char digits[] = "0123456789abcdef";
+  std::string out(size * 2, '0');
+  for (unsigned i = 0; i < size; ++i) {
+    out[i * 2] = digits[data[i] >> 4];
+    out[i * 2 + 1] = digits[data[i] & 0xf];
+  }
+  return out;
+}
+
+int hash_file(const std::string &path, const EVP_MD *md,
+              std::vector<char> &buffer, std::string &digest,
+              std::uint64_t &bytes) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+  if (fd < 0) {
+    return errno;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+  bool ok = ctx && EVP_DigestInit_ex(ctx, md, nullptr) == 1;
+
+  ssize_t n = 0;
+  while (ok && (n = read(fd, buffer.data(), buffer.size())) > 0) {
+    ok = EVP_DigestUpdate(ctx, buffer.data(), static_cast<std::size_t>(n)) == 1;
+    bytes += static_cast<std::uint64_t>(n);
+  }
+  int error = n < 0 ? errno : 0;
+  ok = ok && n == 0;
+
+  std::array<unsigned char, EVP_MAX_MD_SIZE> out{};
+  unsigned size = 0;
+  ok = ok && EVP_DigestFinal_ex(ctx, out.data(), &size) == 1;
+  if (ok) {
+    digest = to_hex(out.data(), size);
+  } else if (error == 0) {
+    error = EIO;
+  }
+
+  EVP_MD_CTX_free(ctx);
+  close(fd);
+  return error;
+}
+
+std::string octal(int mode) {
+  char buffer[16];
+  std::snprintf(buffer, sizeof(buffer), "%o", mode);
+  return buffer;
+}
+
+bool type_matches(FileEntry::Type type, mode_t mode) {
+  switch (type) {
+  case FileEntry::Type::File:
+    return S_ISREG(mode);
+  case FileEntry::Type::Directory:
+    return S_ISDIR(mode);
+  case FileEntry::Type::Symlink:
+    return S_ISLNK(mode);
+  }
+  return false;
+}
+
+template <typename Report>
+void check_file(const std::string &root, const FileEntry &entry,
+                std::vector<char> &buffer, VerifyProgress &progress,
+                Report &&report) {
+  std::string path = root;
+  if (path.empty() || path.back() != '/') {
+    path += '/';
+  }
+  path += entry.path;
+
+  struct stat st {};
+  if (lstat(path.c_str(), &st) != 0) {
+    int error = errno;
+    if (error == ENOENT || error == ENOTDIR) {
+      report(VerifyProblem::Missing, std::string());
+    } else {
+      report(VerifyProblem::Unreadable, std::strerror(error));
+    }
+    return;
+  }
+
+  if (!type_matches(entry.type, st.st_mode)) {
+    report(VerifyProblem::Type, std::string());
+    return;
+  }
+
+  if (entry.type == FileEntry::Type::Symlink) {
+    std::array<char, 4096> target{};
+    ssize_t n = readlink(path.c_str(), target.data(), target.size());
+    int error = errno;
+    if (n < 0) {
+      report(VerifyProblem::Unreadable, std::strerror(error));
+    } else if (!entry.link.empty() &&
+               std::string_view(target.data(), static_cast<std::size_t>(n)) !=
+                   entry.link) {
+      report(VerifyProblem::Link,
+             entry.link + " != " +
+                 std::string(target.data(), static_cast<std::size_t>(n)));
+    }
+    return;
+  }
+
+  int mode = static_cast<int>(st.st_mode & 07777);
+  if (entry.mode >= 0 && mode != entry.mode) {
+    report(VerifyProblem::Mode, octal(entry.mode) + " != " + octal(mode));
+  }
+
+  if (entry.type != FileEntry::Type::File || entry.backup) {
+    return;
+  }
+
+  if (entry.size >= 0 && st.st_size != entry.size) {
+    report(VerifyProblem::Size, std::to_string(entry.size) +
+                                    " != " + std::to_string(st.st_size));
+    return;
+  }
+
+  const EVP_MD *md = nullptr;
+  const std::string *expected = nullptr;
+  if (!entry.sha256.empty()) {
+    md = EVP_sha256();
+    expected = &entry.sha256;
+  } else if (!entry.md5.empty()) {
+    md = EVP_md5();
+    expected = &entry.md5;
+  } else {
+    return;
+  }
+
+  std::string digest;
+  std::uint64_t bytes = 0;
+  int error = hash_file(path, md, buffer, digest, bytes);
+  progress.bytes_hashed.fetch_add(bytes);
+  if (error != 0) {
+    report(VerifyProblem::Unreadable, std::strerror(error));
+  } else if (digest != *expected) {
+    report(VerifyProblem::Checksum, std::string());
+  }
+}
+
+} // namespace
+
+std::string_view problem_label(VerifyProblem problem) {
+  switch (problem) {
+  case VerifyProblem::Missing:
+    return "missing";
+  case VerifyProblem::Unreadable:
+    return "unreadable";
+  case VerifyProblem::Type:
+    return "type mismatch";
+  case VerifyProblem::Mode:
+    return "mode mismatch";
+  case VerifyProblem::Size:
+    return "size mismatch";
+  case VerifyProblem::Checksum:
+    return "checksum mismatch";
+  case VerifyProblem::Link:
+    return "link target mismatch";
+  }
+  return "";
+}
+
+void verify_packages(PackageManager &manager,
+                     const std::vector<Package> &targets,
+                     const std::string &root, unsigned threads,
+                     VerifyProgress &progress, const IssueSink &sink) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  WorkStealingPool pool(threads);
+
+  std::vector<std::vector<FileEntry>> manifests(targets.size());
+  std::vector<std::vector<char>> buffers(pool.size());
+  std::mutex sink_mutex;
+
+  progress.packages_total.fetch_add(targets.size());
+  for (std::size_t i = 0; i < targets.size(); ++i) {
+    pool.push(static_cast<unsigned>(i % pool.size()),
+              Job{static_cast<std::uint32_t>(i), -1});
+  }
+
+  pool.run([&](unsigned worker, Job job) {
+    if (progress.cancel.load()) {
+      return;
+    }
+
+    auto &files = manifests[job.package];
+    if (job.file < 0) {
+      manager.listFiles(targets[job.package], files);
+      progress.files_total.fetch_add(files.size());
+      progress.packages_done.fetch_add(1);
+      for (std::size_t f = 0; f < files.size(); ++f) {
+        pool.push(worker, Job{job.package, static_cast<std::int32_t>(f)});
+      }
+      return;
+    }
+
+    auto &buffer = buffers[worker];
+    if (buffer.empty()) {
+      buffer.resize(hash_buffer_size);
+    }
+
+    const FileEntry &entry = files[job.file];
+    check_file(root, entry, buffer, progress,
+               [&](VerifyProblem problem, std::string detail) {
+                 VerifyIssue issue;
+                 issue.package = targets[job.package].name;
+                 issue.path = "/" + entry.path;
+                 issue.problem = problem;
+                 issue.detail = std::move(detail);
+                 progress.issues.fetch_add(1);
+                 std::lock_guard<std::mutex> lock(sink_mutex);
+                 sink(issue);
+               });
+    progress.files_done.fetch_add(1);
+  });
+}
+
+} // namespace pkg
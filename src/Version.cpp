@@ -0,0 +1,297 @@
+#include "Version.h"
+
+#include <cctype>
+
+namespace pkg {
+
+namespace {
+
+bool is_alnum(char c) { return std::isalnum(static_cast<unsigned char>(c)); }
+bool is_alpha(char c) { return std::isalpha(static_cast<unsigned char>(c)); }
+bool is_digit(char c) { return std::isdigit(static_cast<unsigned char>(c)); }
+
+int segment_cmp(std::string_view a, std::string_view b) {
+  if (a == b) {
+    return 0;
+  }
+
+  std::size_t i = 0;
+  std::size_t j = 0;
+
+  while (i < a.size() && j < b.size()) {
+    std::size_t sep_a = i;
+    std::size_t sep_b = j;
+    while (i < a.size() && !is_alnum(a[i])) {
+      ++i;
+    }
+    while (j < b.size() && !is_alnum(b[j])) {
+      ++j;
+    }
+
+    if (i >= a.size() || j >= b.size()) {
+      break;
+    }
+
+    if (i - sep_a != j - sep_b) {
+      return i - sep_a < j - sep_b ? -1 : 1;
+    }
+
+    std::size_t end_a = i;
+    std::size_t end_b = j;
+    bool numeric = is_digit(a[i]);
+    if (numeric) {
+      while (end_a < a.size() && is_digit(a[end_a])) {
+        ++end_a;
+      }
+      while (end_b < b.size() && is_digit(b[end_b])) {
+        ++end_b;
+      }
+    } else {
+      while (end_a < a.size() && is_alpha(a[end_a])) {
+        ++end_a;
+      }
+      while (end_b < b.size() && is_alpha(b[end_b])) {
+        ++end_b;
+      }
+    }
+
+    if (end_b == j) {
+      return numeric ? 1 : -1;
+    }
+
+    std::string_view seg_a = a.substr(i, end_a - i);
+    std::string_view seg_b = b.substr(j, end_b - j);
+
+    if (numeric) {
+      while (!seg_a.empty() && seg_a.front() == '0') {
+        seg_a.remove_prefix(1);
+      }
+      while (!seg_b.empty() && seg_b.front() == '0') {
+        seg_b.remove_prefix(1);
+      }
+      if (seg_a.size() != seg_b.size()) {
+        return seg_a.size() > seg_b.size() ? 1 : -1;
+      }
+    }
+
+    int rc = seg_a.compare(seg_b);
+    if (rc != 0) {
+      return rc < 0 ? -1 : 1;
+    }
+
+    i = end_a;
+    j = end_b;
+  }
+
+  if (i >= a.size() && j >= b.size()) {
+    return 0;
+  }
+
+  if ((i >= a.size() && !is_alpha(b[j])) || (i < a.size() && is_alpha(a[i]))) {
+    return -1;
+  }
+  return 1;
+}
+
+struct Evr {
+  std::string_view epoch = "0";
+  std::string_view version;
+  std::string_view release;
+};
+
+Evr parse_evr(std::string_view text) {
+  Evr evr;
+
+  std::size_t i = 0;
+  while (i < text.size() && is_digit(text[i])) {
+    ++i;
+  }
+  if (i < text.size() && text[i] == ':') {
+    if (i > 0) {
+      evr.epoch = text.substr(0, i);
+    }
+    text.remove_prefix(i + 1);
+  }
+
+  std::size_t dash = text.rfind('-');
+  if (dash != std::string_view::npos) {
+    evr.release = text.substr(dash + 1);
+    text = text.substr(0, dash);
+  }
+  evr.version = text;
+  return evr;
+}
+
+int deb_order(char c) {
+  if (is_digit(c)) {
+    return 0;
+  } else if (is_alpha(c)) {
+    return static_cast<unsigned char>(c);
+  } else if (c == '~') {
+    return -1;
+  } else if (c != '\0') {
+    return static_cast<unsigned char>(c) + 256;
+  }
+  return 0;
+}
+
+int deb_segment_cmp(std::string_view a, std::string_view b) {
+  auto at = [](std::string_view s, std::size_t i) {
+    return i < s.size() ? s[i] : '\0';
+  };
+
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < a.size() || j < b.size()) {
+    while ((i < a.size() && !is_digit(a[i])) ||
+           (j < b.size() && !is_digit(b[j]))) {
+      int ac = deb_order(at(a, i));
+      int bc = deb_order(at(b, j));
+      if (ac != bc) {
+        return ac < bc ? -1 : 1;
+      }
+      ++i;
+      ++j;
+    }
+
+    while (at(a, i) == '0') {
+      ++i;
+    }
+    while (at(b, j) == '0') {
+      ++j;
+    }
+
+    int first_diff = 0;
+    while (is_digit(at(a, i)) && is_digit(at(b, j))) {
+      if (first_diff == 0) {
+        first_diff = a[i] - b[j];
+      }
+      ++i;
+      ++j;
+    }
+    if (is_digit(at(a, i))) {
+      return 1;
+    }
+    if (is_digit(at(b, j))) {
+      return -1;
+    }
+    if (first_diff != 0) {
+      return first_diff < 0 ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+VersionScheme scheme_for_source(std::string_view source) {
+  return source == "dpkg" ? VersionScheme::Debian : VersionScheme::Alpm;
+}
+
+int vercmp(std::string_view a, std::string_view b, VersionScheme scheme) {
+  if (a == b) {
+    return 0;
+  }
+
+  if (scheme == VersionScheme::Debian) {
+    Evr ea = parse_evr(a);
+    Evr eb = parse_evr(b);
+    int rc = deb_segment_cmp(ea.epoch, eb.epoch);
+    if (rc == 0) {
+      rc = deb_segment_cmp(ea.version, eb.version);
+    }
+    if (rc == 0) {
+      rc = deb_segment_cmp(ea.release, eb.release);
+    }
+    return rc;
+  }
+
+  Evr ea = parse_evr(a);
+  Evr eb = parse_evr(b);
+
+  int rc = segment_cmp(ea.epoch, eb.epoch);
+  if (rc == 0) {
+    rc = segment_cmp(ea.version, eb.version);
+    if (rc == 0 && !ea.release.empty() && !eb.release.empty()) {
+      rc = segment_cmp(ea.release, eb.release);
+    }
+  }
+  return rc;
+}
+
+Constraint parse_constraint(std::string_view text) {
+  Constraint c;
+
+  text = text.substr(0, text.find('|'));
+  while (!text.empty() && text.front() == ' ') {
+    text.remove_prefix(1);
+  }
+
+  std::size_t end = text.find_first_of(" (<>=");
+  c.name = text.substr(0, end);
+
+  std::size_t op = text.find_first_of("<>=", end);
+  if (op == std::string_view::npos) {
+    return c;
+  }
+
+  std::string_view rest = text.substr(op);
+  if (rest.substr(0, 2) == "<=") {
+    c.op = VersionOp::LessEqual;
+    rest.remove_prefix(2);
+  } else if (rest.substr(0, 2) == ">=") {
+    c.op = VersionOp::GreaterEqual;
+    rest.remove_prefix(2);
+  } else if (rest.substr(0, 2) == "<<") {
+    c.op = VersionOp::Less;
+    rest.remove_prefix(2);
+  } else if (rest.substr(0, 2) == ">>") {
+    c.op = VersionOp::Greater;
+    rest.remove_prefix(2);
+  } else if (rest.front() == '<') {
+    c.op = VersionOp::Less;
+    rest.remove_prefix(1);
+  } else if (rest.front() == '>') {
+    c.op = VersionOp::Greater;
+    rest.remove_prefix(1);
+  } else {
+    c.op = VersionOp::Equal;
+    rest.remove_prefix(1);
+  }
+
+  while (!rest.empty() && rest.front() == ' ') {
+    rest.remove_prefix(1);
+  }
+  while (!rest.empty() && (rest.back() == ' ' || rest.back() == ')')) {
+    rest.remove_suffix(1);
+  }
+
+  c.version = rest;
+  return c;
+}
+
+bool satisfies(std::string_view version, VersionOp op, std::string_view wanted,
+               VersionScheme scheme) {
+  if (op == VersionOp::Any) {
+    return true;
+  }
+
+  int rc = vercmp(version, wanted, scheme);
+  switch (op) {
+  case VersionOp::Less:
+    return rc < 0;
+  case VersionOp::LessEqual:
+    return rc <= 0;
+  case VersionOp::Equal:
+    return rc == 0;
+  case VersionOp::GreaterEqual:
+    return rc >= 0;
+  case VersionOp::Greater:
+    return rc > 0;
+  case VersionOp::Any:
+    break;
+  }
+  return true;
+}
+
+} // namespace pkg
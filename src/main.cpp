@@ -1,20 +1,97 @@
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <random>
 #include <ncurses.h>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
 #include <vector>
 
+#include "CompositePackageManager.h"
+#include "Daemon.h"
+#include "DependencyIndex.h"
+#include "DependencyTree.h"
+#include "Dominators.h"
+#include "DpkgPackageManager.h"
 #include "DummyPackageManager.h"
+#include "History.h"
+#include "MemStats.h"
 #include "PackageManager.h"
 #include "PacmanPackageManager.h"
+#include "Protocol.h"
+#include "RemotePackageManager.h"
+#include "Replay.h"
+#include "Search.h"
+#include "Snapshot.h"
+#include "TextStore.h"
+#include "Verifier.h"
+#include "Version.h"
 
 namespace {
 
-enum class FilterMode { All, ExplicitOnly, AurOnly };
-
-enum class SortMode { NameAsc, NameDesc, ExplicitFirst, AurFirst };
+enum class FilterMode { All, ExplicitOnly, AurOnly, BrokenDeps, ChangedSince };
+
+enum class SortMode { NameAsc, NameDesc, ExplicitFirst, AurFirst, Footprint };
+
+using Clock = std::chrono::steady_clock;
+
+constexpr pkg::FieldMask list_fields =
+    pkg::field::All & ~pkg::field::RequiredBy;
+
+const char *const history_logs[] = {"/var/log/pacman.log", "/var/log/dpkg.log"};
+
+struct ChangeWindow {
+  const pkg::History *history = nullptr;
+  std::int64_t since = 0;
+};
+
+struct LoadChannel {
+  std::mutex mutex;
+  std::vector<pkg::Package> pending;
+  pkg::History history;
+  bool done = false;
+};
+
+struct VerifyChannel {
+  std::mutex mutex;
+  std::vector<pkg::VerifyIssue> issues;
+  pkg::VerifyProgress progress;
+  bool done = false;
+};
+
+struct DetailsChannel {
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<std::pair<int, pkg::Package>> queue;
+  std::vector<std::pair<int, pkg::Package>> done;
+  bool stop = false;
+};
+
+struct LoadStats {
+  Clock::time_point start;
+  double first_frame_ms = -1.0;
+  double first_batch_ms = -1.0;
+  double load_done_ms = -1.0;
+  int batches = 0;
+  std::size_t packages = 0;
+  pkg::TextStoreStats descriptions;
+};
+
+double ms_since(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
 
 WINDOW *create_window(int h, int w, int y, int x, const std::string &title) {
   WINDOW *win = newwin(h, w, y, x);
@@ -37,38 +114,20 @@ std::string to_lower(const std::string &s) {
   return out;
 }
 
-bool fuzzy_match(const std::string &pattern, const std::string &text) {
-  if (pattern.empty())
-    return true;
-
-  std::string p = to_lower(pattern);
-  std::string t = to_lower(text);
-
-  std::size_t ti = 0;
-  for (char pc : p) {
-    bool found = false;
-    while (ti < t.size()) {
-      if (t[ti] == pc) {
-        found = true;
-        ++ti;
-        break;
-      }
-      ++ti;
-    }
-    if (!found) {
-      return false;
-    }
-  }
-  return true;
-}
-
-bool filter_accept(const pkg::Package &pkg, FilterMode mode) {
+bool filter_accept(const pkg::Package &pkg, int index,
+                   const pkg::DependencyIndex &deps,
+                   const ChangeWindow &changes, FilterMode mode) {
   if (mode == FilterMode::All) {
     return true;
   } else if (mode == FilterMode::ExplicitOnly) {
     return pkg.is_explicit;
   } else if (mode == FilterMode::AurOnly) {
     return pkg.is_foreign;
+  } else if (mode == FilterMode::BrokenDeps) {
+    return index < static_cast<int>(deps.size()) && deps.has_broken(index);
+  } else if (mode == FilterMode::ChangedSince) {
+    return changes.history &&
+           changes.history->changed_since(pkg.name, pkg.source, changes.since);
   }
   return true;
 }
@@ -104,29 +163,216 @@ bool sort_less(const pkg::Package &a, const pkg::Package &b, SortMode mode) {
   return false;
 }
 
-void recompute_visible_indices(const std::vector<pkg::Package> &packages,
-                               const std::string &query, FilterMode filter_mode,
-                               SortMode sort_mode,
-                               std::vector<int> &visible_indices) {
-  visible_indices.clear();
+std::uint64_t exclusive_size(const pkg::DominatorTree &dominators,
+                             int index) {
+  if (index >= static_cast<int>(dominators.size())) {
+    return 0;
+  }
+  return dominators.exclusive(index).size;
+}
+
+std::string format_size(std::uint64_t bytes) {
+  const char *units = "BKMGT";
+  double value = static_cast<double>(bytes);
+  int unit = 0;
+  while (value >= 1024.0 && unit < 4) {
+    value /= 1024.0;
+    ++unit;
+  }
+  char buffer[16];
+  if (unit == 0 || value >= 10.0) {
+    std::snprintf(buffer, sizeof(buffer), "%.0f%c", value, units[unit]);
+  } else {
+    std::snprintf(buffer, sizeof(buffer), "%.1f%c", value, units[unit]);
+  }
+  return buffer;
+}
 
-  for (int i = 0; i < static_cast<int>(packages.size()); ++i) {
+void merge_visible_indices(const std::vector<pkg::Package> &packages,
+                           const pkg::DependencyIndex &deps,
+                           const pkg::DominatorTree &dominators,
+                           const ChangeWindow &changes, int first_new,
+                           const std::string &query,
+                           FilterMode filter_mode, SortMode sort_mode,
+                           std::vector<int> &visible_indices) {
+  pkg::MemScope scope(pkg::MemTag::Search);
+
+  std::size_t old_size = visible_indices.size();
+
+  for (int i = first_new; i < static_cast<int>(packages.size()); ++i) {
     const auto &pkg = packages[i];
-    if (!filter_accept(pkg, filter_mode)) {
+    if (!filter_accept(pkg, i, deps, changes, filter_mode)) {
       continue;
     }
-    if (!query.empty() && !fuzzy_match(query, pkg.name)) {
+    if (!query.empty() && !pkg::fuzzy_match(query, pkg.name)) {
       continue;
     }
     visible_indices.push_back(i);
   }
 
-  std::sort(visible_indices.begin(), visible_indices.end(),
-            [&](int ia, int ib) {
-              const auto &a = packages[ia];
-              const auto &b = packages[ib];
-              return sort_less(a, b, sort_mode);
-            });
+  auto less = [&](int ia, int ib) {
+    const auto &a = packages[ia];
+    const auto &b = packages[ib];
+    if (sort_mode == SortMode::Footprint) {
+      std::uint64_t sa = exclusive_size(dominators, ia);
+      std::uint64_t sb = exclusive_size(dominators, ib);
+      if (sa != sb) {
+        return sa > sb;
+      }
+      return sort_less(a, b, SortMode::NameAsc);
+    }
+    return sort_less(a, b, sort_mode);
+  };
+  std::sort(visible_indices.begin() + old_size, visible_indices.end(), less);
+  std::inplace_merge(visible_indices.begin(),
+                     visible_indices.begin() + old_size, visible_indices.end(),
+                     less);
+}
+
+void recompute_visible_indices(const std::vector<pkg::Package> &packages,
+                               const pkg::DependencyIndex &deps,
+                               const pkg::DominatorTree &dominators,
+                               const ChangeWindow &changes,
+                               const std::string &query, FilterMode filter_mode,
+                               SortMode sort_mode,
+                               std::vector<int> &visible_indices) {
+  visible_indices.clear();
+  merge_visible_indices(packages, deps, dominators, changes, 0, query,
+                        filter_mode, sort_mode, visible_indices);
+}
+
+struct IndexedFields {
+  std::vector<std::string> depends_on;
+  std::vector<std::string> provides;
+  bool is_explicit = false;
+  std::uint64_t installed_size = 0;
+};
+
+IndexedFields indexed_fields(const pkg::Package &pkg) {
+  return {pkg.depends_on, pkg.provides, pkg.is_explicit, pkg.installed_size};
+}
+
+void update_indexes(const IndexedFields &before,
+                    const std::vector<pkg::Package> &packages,
+                    pkg::DependencyIndex &deps, pkg::DominatorTree &dominators,
+                    int index) {
+  if (index >= static_cast<int>(deps.size())) {
+    return;
+  }
+
+  const pkg::Package &pkg = packages[index];
+  pkg::MemScope scope(pkg::MemTag::Index);
+  if (pkg.provides != before.provides) {
+    deps.build(packages);
+    dominators.build(packages, deps);
+  } else if (pkg.depends_on != before.depends_on ||
+             pkg.is_explicit != before.is_explicit ||
+             pkg.installed_size != before.installed_size) {
+    deps.update(packages, index);
+    dominators.update(packages, deps, index);
+  }
+}
+
+void compact_descriptions(std::vector<pkg::Package> &packages,
+                          pkg::TextStore &descriptions) {
+  std::vector<std::string_view> texts;
+  texts.reserve(packages.size());
+  for (const auto &pkg : packages) {
+    texts.push_back(pkg.description);
+  }
+  if (!descriptions.build(texts)) {
+    return;
+  }
+  for (auto &pkg : packages) {
+    std::string().swap(pkg.description);
+  }
+}
+
+std::size_t description_cache_blocks(int list_height, std::size_t blocks) {
+  std::size_t rows = static_cast<std::size_t>(std::max(list_height, 4));
+  return std::clamp<std::size_t>(blocks / 4, 4, rows);
+}
+
+void store_description(pkg::TextStore &descriptions, pkg::Package &pkg,
+                       int index) {
+  if (pkg.description.empty() ||
+      static_cast<std::size_t>(index) >= descriptions.size()) {
+    return;
+  }
+  pkg::MemScope scope(pkg::MemTag::Packages);
+  std::string stored;
+  descriptions.get(index, stored);
+  if (pkg.description != stored &&
+      !descriptions.set(index, pkg.description)) {
+    return;
+  }
+  std::string().swap(pkg.description);
+}
+
+pkg::Package details_request(const pkg::Package &pkg) {
+  pkg::Package request;
+  request.name = pkg.name;
+  request.version = pkg.version;
+  request.source = pkg.source;
+  return request;
+}
+
+void apply_details(pkg::Package &target, pkg::Package &&fetched) {
+  auto take = [](auto &to, auto &from) {
+    if (!from.empty()) {
+      to = std::move(from);
+    }
+  };
+  take(target.description, fetched.description);
+  take(target.repo, fetched.repo);
+  take(target.architecture, fetched.architecture);
+  take(target.install_date, fetched.install_date);
+  take(target.depends_on, fetched.depends_on);
+  take(target.required_by, fetched.required_by);
+  take(target.provides, fetched.provides);
+  take(target.conflicts, fetched.conflicts);
+  take(target.replaces, fetched.replaces);
+}
+
+void fill_details(pkg::PackageManager &manager,
+                  std::vector<pkg::Package> &packages,
+                  pkg::TextStore &descriptions, std::vector<char> &requested,
+                  pkg::DependencyIndex &deps, pkg::DominatorTree &dominators,
+                  int index) {
+  requested.resize(packages.size(), 0);
+  if (requested[index]) {
+    return;
+  }
+  requested[index] = 1;
+
+  pkg::Package fetched = details_request(packages[index]);
+  {
+    pkg::MemScope scope(pkg::MemTag::Backend);
+    manager.fillDetails(fetched);
+  }
+  IndexedFields before = indexed_fields(packages[index]);
+  apply_details(packages[index], std::move(fetched));
+  store_description(descriptions, packages[index], index);
+  update_indexes(before, packages, deps, dominators, index);
+}
+
+bool select_global_index(int global_index,
+                         const std::vector<int> &visible_indices,
+                         int list_height, int &selected_visible_index,
+                         int &scroll_offset) {
+  auto it = std::find(visible_indices.begin(), visible_indices.end(),
+                      global_index);
+  if (it == visible_indices.end()) {
+    return false;
+  }
+
+  selected_visible_index = static_cast<int>(it - visible_indices.begin());
+  if (selected_visible_index < scroll_offset) {
+    scroll_offset = selected_visible_index;
+  } else if (selected_visible_index >= scroll_offset + list_height) {
+    scroll_offset = selected_visible_index - list_height + 1;
+  }
+  return true;
 }
 
 std::string filter_mode_label(FilterMode mode) {
@@ -137,6 +383,10 @@ std::string filter_mode_label(FilterMode mode) {
     return "Explicit";
   case FilterMode::AurOnly:
     return "AUR";
+  case FilterMode::BrokenDeps:
+    return "Broken";
+  case FilterMode::ChangedSince:
+    return "Changed";
   }
   return "";
 }
@@ -151,15 +401,21 @@ std::string sort_mode_label(SortMode mode) {
     return "Explicit↑";
   case SortMode::AurFirst:
     return "AUR↑";
+  case SortMode::Footprint:
+    return "Exclusive↓";
   }
   return "";
 }
 
 void render_packages(WINDOW *win, const std::vector<pkg::Package> &packages,
+                     const pkg::DominatorTree &dominators,
                      const std::vector<int> &visible_indices,
                      int selected_visible_index, int scroll_offset,
                      const std::string &search_query, bool search_mode,
-                     FilterMode filter_mode, SortMode sort_mode) {
+                     const std::string &since_input, bool since_mode,
+                     FilterMode filter_mode, SortMode sort_mode,
+                     int loading_count) {
+  pkg::MemScope scope(pkg::MemTag::Render);
   int height, width;
   getmaxyx(win, height, width);
 
@@ -173,12 +429,15 @@ void render_packages(WINDOW *win, const std::vector<pkg::Package> &packages,
   std::string mode_label = filter_mode_label(filter_mode);
   std::string sort_label = sort_mode_label(sort_mode);
   std::string title = " Packages [" + mode_label + "] (" + sort_label + ") ";
+  if (loading_count >= 0) {
+    title += "loading " + std::to_string(loading_count) + "… ";
+  }
   wattron(win, A_BOLD);
   mvwprintw(win, 0, 2, "%s", title.c_str());
   wattroff(win, A_BOLD);
 
-  std::string prompt = "/ ";
-  std::string query_display = search_query;
+  std::string prompt = since_mode ? "since: " : "/ ";
+  std::string query_display = since_mode ? since_input : search_query;
   int max_query_w = width - 4 - static_cast<int>(prompt.size());
   if (static_cast<int>(query_display.size()) > max_query_w) {
     query_display.erase(max_query_w);
@@ -186,7 +445,7 @@ void render_packages(WINDOW *win, const std::vector<pkg::Package> &packages,
 
   mvwprintw(win, search_row, 1, "%-*s", width - 2, "");
   mvwprintw(win, search_row, 2, "%s%s", prompt.c_str(), query_display.c_str());
-  if (search_mode) {
+  if (search_mode || since_mode) {
     wmove(win, search_row,
           2 + static_cast<int>(prompt.size()) +
               static_cast<int>(query_display.size()));
@@ -198,7 +457,8 @@ void render_packages(WINDOW *win, const std::vector<pkg::Package> &packages,
   int max_visible = static_cast<int>(visible_indices.size());
 
   if (max_visible == 0) {
-    std::string msg = "No packages found";
+    std::string msg =
+        loading_count >= 0 ? "Loading packages..." : "No packages found";
     if (static_cast<int>(msg.size()) > width - 2) {
       msg.resize(width - 2);
     }
@@ -229,10 +489,29 @@ void render_packages(WINDOW *win, const std::vector<pkg::Package> &packages,
       line += " [AUR]";
     }
 
-    if (static_cast<int>(line.size()) > width - 2) {
-      line.resize(width - 5);
+    std::string source_col;
+    if (global_index < static_cast<int>(dominators.size())) {
+      std::string size = format_size(exclusive_size(dominators, global_index));
+      if (size.size() < 5) {
+        size.insert(0, 5 - size.size(), ' ');
+      }
+      source_col = " " + size;
+    }
+    if (!pkg.source.empty()) {
+      source_col += " " + pkg.source;
+    }
+    int line_w = width - 2 - static_cast<int>(source_col.size());
+    if (line_w < 4) {
+      source_col.clear();
+      line_w = width - 2;
+    }
+
+    if (static_cast<int>(line.size()) > line_w) {
+      line.resize(line_w - 3);
       line += "...";
     }
+    line.append(line_w - line.size(), ' ');
+    line += source_col;
 
     if (vis_index == selected_visible_index) {
       wattron(win, A_REVERSE);
@@ -246,8 +525,99 @@ void render_packages(WINDOW *win, const std::vector<pkg::Package> &packages,
   wrefresh(win);
 }
 
+std::string dependency_label(const std::vector<pkg::Package> &packages,
+                             const pkg::DependencyIndex &deps, int global_index,
+                             std::size_t dep_index) {
+  const auto &pkg = packages[global_index];
+  std::string label = pkg.depends_on[dep_index];
+  if (global_index >= static_cast<int>(deps.size())) {
+    return label;
+  }
+
+  const auto &edges = deps.depends(global_index);
+  if (dep_index >= edges.size()) {
+    return label;
+  }
+
+  const auto &resolved = edges[dep_index];
+  if (resolved.target < 0) {
+    label += " (missing)";
+  } else if (!resolved.satisfied) {
+    label += " (unmet: " + packages[resolved.target].version + ")";
+  } else if (packages[resolved.target].name !=
+             pkg::parse_constraint(label).name) {
+    label += " -> " + packages[resolved.target].name;
+  }
+  return label;
+}
+
+std::string version_change(const pkg::HistoryEvent &ev) {
+  if (ev.old_version.empty()) {
+    return std::string(ev.new_version);
+  } else if (ev.new_version.empty()) {
+    return std::string(ev.old_version);
+  }
+  return std::string(ev.old_version) + " -> " + std::string(ev.new_version);
+}
+
+std::string tree_label(const std::vector<pkg::Package> &packages,
+                       const pkg::DependencyIndex &deps,
+                       const pkg::DependencyTree::Row &row) {
+  using Direction = pkg::DependencyTree::Direction;
+
+  std::string label(2 * row.depth, ' ');
+  if (row.leaf) {
+    label += row.header ? "  " : "· ";
+  } else if (row.seen) {
+    label += "↺ ";
+  } else {
+    label += row.expanded ? "▾ " : "▸ ";
+  }
+
+  if (row.header) {
+    const auto &pkg = packages[row.package];
+    std::size_t count = row.direction == Direction::Depends
+                            ? pkg.depends_on.size()
+                            : pkg.required_by.size();
+    label += row.direction == Direction::Depends ? "Depends On" : "Required By";
+    label += " (" + std::to_string(count) + ")";
+    return label;
+  }
+
+  const auto &parent = packages[row.parent];
+  if (row.direction == Direction::Depends) {
+    if (row.depth == 1 && row.edge < 9) {
+      label += std::to_string(row.edge + 1) + ":";
+    }
+    if (row.edge < static_cast<int>(parent.depends_on.size())) {
+      label += dependency_label(packages, deps, row.parent,
+                                static_cast<std::size_t>(row.edge));
+    } else if (row.package >= 0) {
+      label += packages[row.package].name;
+    }
+  } else {
+    if (row.edge < static_cast<int>(parent.required_by.size())) {
+      label += parent.required_by[row.edge];
+    }
+    if (row.package < 0) {
+      label += " (not installed)";
+    }
+  }
+
+  if (row.seen) {
+    label += " (seen)";
+  }
+  return label;
+}
+
 void render_details(WINDOW *win, const std::vector<pkg::Package> &packages,
+                    pkg::TextStore &descriptions,
+                    const pkg::DependencyIndex &deps,
+                    const pkg::DominatorTree &dominators,
+                    const pkg::History &history,
+                    const pkg::DependencyTree &tree, bool tree_focus,
                     int global_index) {
+  pkg::MemScope scope(pkg::MemTag::Render);
   int height, width;
   getmaxyx(win, height, width);
 
@@ -279,6 +649,11 @@ void render_details(WINDOW *win, const std::vector<pkg::Package> &packages,
     mvwprintw(win, row, 4, "Source: %s", source_str);
     row++;
 
+    if (!pkg.source.empty()) {
+      mvwprintw(win, row, 4, "Backend: %s", pkg.source.c_str());
+      row++;
+    }
+
     mvwprintw(win, row, 4, "Explicit: %s", pkg.is_explicit ? "yes" : "no");
     row++;
 
@@ -292,69 +667,107 @@ void render_details(WINDOW *win, const std::vector<pkg::Package> &packages,
       row++;
     }
 
-    row += 1;
-    mvwprintw(win, row, 4, "Depends On:");
-    row++;
-
-    if (!pkg.depends_on.empty()) {
-      std::string deps_line;
-      for (std::size_t i = 0; i < pkg.depends_on.size(); ++i) {
-        if (i > 0)
-          deps_line += ", ";
-        deps_line += pkg.depends_on[i];
-      }
-      if (static_cast<int>(deps_line.size()) > width - 8) {
-        deps_line.resize(width - 11);
-        deps_line += "...";
+    if (global_index < static_cast<int>(dominators.size())) {
+      const pkg::Footprint &fp = dominators.exclusive(global_index);
+      std::string line = "Exclusive: " + std::to_string(fp.count) +
+                         (fp.count == 1 ? " package, " : " packages, ") +
+                         format_size(fp.size);
+      int idom = dominators.idom(global_index);
+      if (idom >= 0) {
+        line += " (kept by " + packages[idom].name + ")";
       }
-      mvwprintw(win, row, 6, "%.*s", width - 8, deps_line.c_str());
-    } else {
-      mvwprintw(win, row, 6, "(none)");
+      mvwprintw(win, row, 4, "%.*s", width - 6, line.c_str());
+      row++;
     }
 
-    row += 2;
-    mvwprintw(win, row, 4, "Required By:");
-    row++;
-
-    if (!pkg.required_by.empty()) {
-      std::string req_line;
-      for (std::size_t i = 0; i < pkg.required_by.size(); ++i) {
+    if (!pkg.provides.empty()) {
+      std::string provides_line;
+      for (std::size_t i = 0; i < pkg.provides.size(); ++i) {
         if (i > 0)
-          req_line += ", ";
-        req_line += pkg.required_by[i];
+          provides_line += ", ";
+        provides_line += pkg.provides[i];
       }
-      if (static_cast<int>(req_line.size()) > width - 8) {
-        req_line.resize(width - 11);
-        req_line += "...";
+      if (static_cast<int>(provides_line.size()) > width - 18) {
+        provides_line.resize(width - 21);
+        provides_line += "...";
       }
-      mvwprintw(win, row, 6, "%.*s", width - 8, req_line.c_str());
-    } else {
-      mvwprintw(win, row, 6, "(none)");
+      row += 2;
+      mvwprintw(win, row, 4, "Provides: %.*s", width - 18,
+                provides_line.c_str());
     }
 
     row += 2;
     mvwprintw(win, row, 4, "Description:");
     row++;
 
-    if (!pkg.description.empty()) {
-      mvwprintw(win, row, 6, "%.*s", width - 8, pkg.description.c_str());
+    std::string stored;
+    const std::string *description = &pkg.description;
+    if (description->empty() && descriptions.get(global_index, stored)) {
+      description = &stored;
+    }
+    if (!description->empty()) {
+      mvwprintw(win, row, 6, "%.*s", width - 8, description->c_str());
     } else {
       mvwprintw(win, row, 6, "(none)");
     }
 
+    auto events = history.for_package(pkg.name, pkg.source);
+    if (!events.empty() && row + 3 < height - 2) {
+      row += 2;
+      mvwprintw(win, row, 4, "History:");
+      row++;
+      int last = tree_focus ? std::min(row + 5, height - 3) : height - 3;
+      for (auto it = events.rbegin(); it != events.rend() && row < last;
+           ++it, ++row) {
+        const auto &ev = **it;
+        std::string line = pkg::format_timestamp(ev.time) + " " +
+                           std::string(pkg::action_label(ev.action)) + " " +
+                           version_change(ev);
+        mvwprintw(win, row, 6, "%.*s", width - 8, line.c_str());
+      }
+      row--;
+    }
+
+    row += 2;
+    int tree_rows = height - 3 - row;
+    const auto &rows = tree.rows();
+    if (tree.root() == global_index && tree_rows > 0) {
+      int first = tree.cursor() < tree_rows ? 0 : tree.cursor() - tree_rows + 1;
+      for (int i = first;
+           i < static_cast<int>(rows.size()) && i < first + tree_rows; ++i) {
+        std::string line = tree_label(packages, deps, rows[i]);
+        bool highlight = tree_focus && i == tree.cursor();
+        if (highlight) {
+          wattron(win, A_REVERSE);
+        }
+        mvwprintw(win, row + i - first, 4, "%-*.*s", width - 6, width - 6,
+                  line.c_str());
+        if (highlight) {
+          wattroff(win, A_REVERSE);
+        }
+      }
+    }
+
   } else {
     mvwprintw(win, 4, 4, "(none)");
   }
 
-  mvwprintw(
-      win, height - 2, 2,
-      "Up/Down, / search, f filter, o order, h/? help, ESC clear, q quit");
+  if (tree_focus) {
+    mvwprintw(win, height - 2, 2,
+              "Tree: Up/Down move, Right expand, Left collapse, Enter jump, "
+              "Esc back");
+  } else {
+    mvwprintw(win, height - 2, 2,
+              "Up/Down, 1-9 jump to dep, t tree, / search, f filter, c since, "
+              "o order, h/? help, q quit");
+  }
 
   wrefresh(win);
 }
 
 void render_help_overlay(int max_y, int max_x) {
-  int h = 15;
+  pkg::MemScope scope(pkg::MemTag::Render);
+  int h = 18;
   int w = 46;
   if (h > max_y - 2)
     h = max_y - 2;
@@ -376,8 +789,13 @@ void render_help_overlay(int max_y, int max_x) {
   mvwprintw(win, row++, 2, "/       : Search packages");
   mvwprintw(win, row++, 2, "ESC     : Clear search");
   mvwprintw(win, row++, 2, "Enter   : Exit search mode");
-  mvwprintw(win, row++, 2, "f       : Filter (All/Explicit/AUR)");
-  mvwprintw(win, row++, 2, "o       : Order (Name/Explicit/AUR)");
+  mvwprintw(win, row++, 2, "1-9     : Jump to Nth dependency");
+  mvwprintw(win, row++, 2, "t / Tab : Browse dependency tree");
+  mvwprintw(win, row++, 2, "f       : Filter (All/Explicit/AUR/Broken)");
+  mvwprintw(win, row++, 2, "c       : Changed since (2024-05-01, 3d)");
+  mvwprintw(win, row++, 2, "o       : Order (Name/Explicit/AUR/Exclusive)");
+  mvwprintw(win, row++, 2, "v / V   : Verify files (selected / all)");
+  mvwprintw(win, row++, 2, "s       : Toggle load statistics");
   mvwprintw(win, row++, 2, "h or ?  : Toggle this help");
   mvwprintw(win, row++, 2, "q       : Quit");
 
@@ -387,15 +805,572 @@ void render_help_overlay(int max_y, int max_x) {
   delwin(win);
 }
 
-bool has_pacman() {
-  int rc = std::system("pacman -V > /dev/null 2>&1");
-  return rc == 0;
+void render_stats_overlay(int max_y, int max_x, const LoadStats &stats,
+                          std::size_t package_count,
+                          const pkg::KeystrokeAllocations &key_allocs) {
+  pkg::MemScope scope(pkg::MemTag::Render);
+  bool memory = pkg::mem_stats_enabled();
+  int h = memory ? 10 + 4 + static_cast<int>(pkg::mem_tag_count) : 10;
+  int w = memory ? 54 : 46;
+  if (h > max_y - 2)
+    h = max_y - 2;
+  if (w > max_x - 2)
+    w = max_x - 2;
+
+  int starty = (max_y - h) / 2;
+  int startx = (max_x - w) / 2;
+
+  WINDOW *win = newwin(h, w, starty, startx);
+  box(win, 0, 0);
+
+  wattron(win, A_BOLD);
+  mvwprintw(win, 0, 2, " Statistics ");
+  wattroff(win, A_BOLD);
+
+  int row = 2;
+  mvwprintw(win, row++, 2, "Packages         : %zu", package_count);
+  mvwprintw(win, row++, 2, "Batches          : %d", stats.batches);
+  mvwprintw(win, row++, 2, "First frame      : %.1f ms", stats.first_frame_ms);
+  if (stats.first_batch_ms >= 0) {
+    mvwprintw(win, row++, 2, "First batch      : %.1f ms",
+              stats.first_batch_ms);
+  } else {
+    mvwprintw(win, row++, 2, "First batch      : pending");
+  }
+  if (stats.load_done_ms >= 0) {
+    mvwprintw(win, row++, 2, "Load complete    : %.1f ms", stats.load_done_ms);
+  } else {
+    mvwprintw(win, row++, 2, "Load complete    : loading");
+  }
+  if (stats.descriptions.entries > 0) {
+    mvwprintw(win, row++, 2, "Descriptions     : %s in %s",
+              format_size(stats.descriptions.raw_bytes).c_str(),
+              format_size(stats.descriptions.footprint()).c_str());
+  }
+
+  if (memory) {
+    pkg::MemReport report = pkg::mem_report();
+    row++;
+    mvwprintw(win, row++, 2, "RSS              : %.1f MiB",
+              static_cast<double>(report.rss_bytes) / (1024.0 * 1024.0));
+    for (std::size_t i = 0; i < pkg::mem_tag_count; ++i) {
+      std::string label(pkg::mem_tag_label(static_cast<pkg::MemTag>(i)));
+      label[0] = static_cast<char>(std::toupper(label[0]));
+      const pkg::MemTagStats &tag = report.tags[i];
+      mvwprintw(win, row++, 2, "%-17s: %.1f MiB in %llu blocks", label.c_str(),
+                static_cast<double>(tag.live_bytes) / (1024.0 * 1024.0),
+                static_cast<unsigned long long>(tag.live_blocks));
+    }
+    mvwprintw(win, row++, 2, "malloc/ncurses   : %.1f MiB",
+              static_cast<double>(report.untracked_bytes) / (1024.0 * 1024.0));
+    mvwprintw(win, row++, 2, "Allocs per key   : %.1f (%zu keys)",
+              key_allocs.keys() ? static_cast<double>(key_allocs.total()) /
+                                      static_cast<double>(key_allocs.keys())
+                                : 0.0,
+              key_allocs.keys());
+  }
+
+  mvwprintw(win, h - 2, 2, "Press s to close");
+
+  wrefresh(win);
+  delwin(win);
 }
 
-} // namespace
+std::string describe_issue(const pkg::VerifyIssue &issue) {
+  std::string line = issue.package + ": " + issue.path + ": " +
+                     std::string(pkg::problem_label(issue.problem));
+  if (!issue.detail.empty()) {
+    line += " (" + issue.detail + ")";
+  }
+  return line;
+}
 
-int main() {
-  initscr();
+void render_verify_overlay(int max_y, int max_x, VerifyChannel &verify) {
+  pkg::MemScope scope(pkg::MemTag::Render);
+  int h = max_y - 4;
+  int w = max_x - 8;
+  if (h < 10)
+    h = max_y - 2;
+  if (w < 40)
+    w = max_x - 2;
+
+  int starty = (max_y - h) / 2;
+  int startx = (max_x - w) / 2;
+
+  WINDOW *win = newwin(h, w, starty, startx);
+  box(win, 0, 0);
+
+  wattron(win, A_BOLD);
+  mvwprintw(win, 0, 2, " Verify ");
+  wattroff(win, A_BOLD);
+
+  const auto &progress = verify.progress;
+  std::lock_guard<std::mutex> lock(verify.mutex);
+
+  int row = 2;
+  mvwprintw(win, row++, 2, "Packages : %zu / %zu",
+            progress.packages_done.load(), progress.packages_total.load());
+  mvwprintw(win, row++, 2, "Files    : %zu / %zu", progress.files_done.load(),
+            progress.files_total.load());
+  mvwprintw(win, row++, 2, "Hashed   : %.1f MiB",
+            static_cast<double>(progress.bytes_hashed.load()) /
+                (1024.0 * 1024.0));
+  mvwprintw(win, row++, 2, "Problems : %zu", verify.issues.size());
+  row++;
+
+  int list_rows = h - 2 - row;
+  std::size_t first = 0;
+  if (list_rows > 0 && verify.issues.size() > std::size_t(list_rows)) {
+    first = verify.issues.size() - list_rows;
+  }
+  for (std::size_t i = first; i < verify.issues.size() && row < h - 2; ++i) {
+    std::string line = describe_issue(verify.issues[i]);
+    mvwprintw(win, row++, 2, "%.*s", w - 4, line.c_str());
+  }
+
+  mvwprintw(win, h - 2, 2, "%s",
+            verify.done ? "Done. Press v to close"
+                        : "Verifying... press v to cancel");
+
+  wrefresh(win);
+  delwin(win);
+}
+
+enum class Mode {
+  Tui,
+  Export,
+  Diff,
+  Histogram,
+  Query,
+  CheckDeps,
+  Since,
+  Verify,
+  Daemon,
+  Bench,
+  Replay,
+  StoreReport
+};
+
+struct Options {
+  Mode mode = Mode::Tui;
+  bool print_timings = false;
+  unsigned jobs = 0;
+  std::string export_path;
+  std::string query;
+  std::string since;
+  std::string root = "/";
+  std::string db_path;
+  bool attach = false;
+  std::string socket_path = pkg::proto::default_socket_path();
+  unsigned clients = 4;
+  std::size_t requests = 2000;
+  std::string replay;
+  std::vector<int> synthetic;
+  bool mem_stats = false;
+  std::vector<std::string> files;
+};
+
+void print_usage(const char *argv0) {
+  std::fprintf(stderr,
+               "usage: %s [--timings] [--mem-stats] [--attach] "
+               "[--socket PATH]\n"
+               "       %s --check-deps [--dbpath DIR]\n"
+               "       %s --since TIME [--jobs N] [LOG...]\n"
+               "       %s --verify [--root DIR] [--dbpath DIR] [--jobs N] "
+               "[PACKAGE...]\n"
+               "       %s --daemon [--socket PATH]\n"
+               "       %s --bench [--clients N] [--requests N] "
+               "[--socket PATH]\n"
+               "       %s --replay SCRIPT|FILE [--synthetic N[,N...]] "
+               "[--mem-stats]\n"
+               "       %s --store-report [--synthetic N]\n"
+               "       %s --export FILE\n"
+               "       %s --diff FROM TO\n"
+               "       %s --histogram [--jobs N] SNAPSHOT...\n"
+               "       %s --query NAME[<op>VERSION] [--jobs N] SNAPSHOT...\n",
+               argv0, argv0, argv0, argv0, argv0, argv0, argv0, argv0, argv0,
+               argv0, argv0, argv0);
+}
+
+bool parse_options(int argc, char **argv, Options &opts) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+
+    if (arg == "--timings") {
+      opts.print_timings = true;
+    } else if (arg == "--mem-stats") {
+      opts.mem_stats = true;
+    } else if (arg == "--check-deps") {
+      opts.mode = Mode::CheckDeps;
+    } else if (arg == "--since" && has_value) {
+      opts.mode = Mode::Since;
+      opts.since = argv[++i];
+    } else if (arg == "--daemon") {
+      opts.mode = Mode::Daemon;
+    } else if (arg == "--bench") {
+      opts.mode = Mode::Bench;
+    } else if (arg == "--replay" && has_value) {
+      opts.mode = Mode::Replay;
+      opts.replay = argv[++i];
+    } else if (arg == "--store-report") {
+      opts.mode = Mode::StoreReport;
+    } else if (arg == "--synthetic" && has_value) {
+      std::string_view list = argv[++i];
+      while (!list.empty()) {
+        std::size_t comma = list.find(',');
+        int count = std::atoi(std::string(list.substr(0, comma)).c_str());
+        if (count <= 0) {
+          return false;
+        }
+        opts.synthetic.push_back(count);
+        list.remove_prefix(comma == std::string_view::npos ? list.size()
+                                                           : comma + 1);
+      }
+    } else if (arg == "--attach") {
+      opts.attach = true;
+    } else if (arg == "--socket" && has_value) {
+      opts.socket_path = argv[++i];
+    } else if (arg == "--clients" && has_value) {
+      opts.clients =
+          static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (arg == "--requests" && has_value) {
+      opts.requests = std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--verify") {
+      opts.mode = Mode::Verify;
+    } else if (arg == "--root" && has_value) {
+      opts.root = argv[++i];
+    } else if (arg == "--dbpath" && has_value) {
+      opts.db_path = argv[++i];
+    } else if (arg == "--export" && has_value) {
+      opts.mode = Mode::Export;
+      opts.export_path = argv[++i];
+    } else if (arg == "--diff") {
+      opts.mode = Mode::Diff;
+    } else if (arg == "--histogram") {
+      opts.mode = Mode::Histogram;
+    } else if (arg == "--query" && has_value) {
+      opts.mode = Mode::Query;
+      opts.query = argv[++i];
+    } else if (arg == "--jobs" && has_value) {
+      opts.jobs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (!arg.empty() && arg[0] != '-') {
+      opts.files.push_back(arg);
+    } else {
+      return false;
+    }
+  }
+
+  switch (opts.mode) {
+  case Mode::Tui:
+  case Mode::Export:
+  case Mode::CheckDeps:
+  case Mode::Bench:
+  case Mode::Replay:
+  case Mode::StoreReport:
+    return opts.files.empty();
+  case Mode::Daemon:
+    return opts.files.empty() && !opts.attach;
+  case Mode::Diff:
+    return opts.files.size() == 2;
+  case Mode::Histogram:
+  case Mode::Query:
+    return !opts.files.empty();
+  case Mode::Since:
+  case Mode::Verify:
+    return true;
+  }
+  return false;
+}
+
+std::shared_ptr<pkg::PackageManager> make_manager(const Options &opts) {
+  if (opts.attach) {
+    return std::make_shared<pkg::RemotePackageManager>(opts.socket_path);
+  }
+  if (!opts.synthetic.empty()) {
+    return std::make_shared<pkg::DummyPackageManager>(opts.synthetic.front());
+  }
+  if (!opts.db_path.empty()) {
+    std::string status = opts.db_path + "/status";
+    if (access(status.c_str(), R_OK) == 0) {
+      return std::make_shared<pkg::DpkgPackageManager>(
+          status, opts.db_path + "/extended_states");
+    }
+    return std::make_shared<pkg::PacmanPackageManager>(opts.db_path);
+  }
+  auto composite = pkg::CompositePackageManager::detect();
+  if (!composite->empty()) {
+    return composite;
+  }
+  return std::make_shared<pkg::DummyPackageManager>();
+}
+
+void load_history(pkg::History &history, unsigned threads = 0) {
+  for (const char *path : history_logs) {
+    history.load(path, threads);
+  }
+}
+
+int run_daemon(const Options &opts) {
+  std::vector<std::string> watch_paths;
+  for (const char *path : {"/var/lib/pacman/local", "/var/lib/dpkg"}) {
+    if (access(path, R_OK) == 0) {
+      watch_paths.emplace_back(path);
+    }
+  }
+  return pkg::run_daemon(make_manager(opts), opts.socket_path, watch_paths);
+}
+
+int run_bench(const Options &opts) {
+  pkg::BenchResult result =
+      pkg::benchmark_daemon(opts.socket_path, opts.clients, opts.requests);
+  if (result.requests == 0) {
+    std::fprintf(stderr, "no responses from %s\n", opts.socket_path.c_str());
+    return 1;
+  }
+
+  std::printf("clients: %u\n", opts.clients);
+  std::printf("requests: %zu (%zu failed)\n", result.requests,
+              result.failures);
+  std::printf("throughput: %.0f req/s\n", result.requests / result.seconds);
+  std::printf("latency p50: %.1f us\n", result.p50_us);
+  std::printf("latency p99: %.1f us\n", result.p99_us);
+  std::printf("latency max: %.1f us\n", result.max_us);
+  return result.failures == 0 ? 0 : 1;
+}
+
+int run_export(const Options &opts) {
+  auto manager = make_manager(opts);
+
+  std::vector<pkg::Package> packages;
+  std::pmr::unsynchronized_pool_resource scratch;
+  manager->visitInstalled(
+      pkg::field::Name | pkg::field::Version | pkg::field::Architecture |
+          pkg::field::Foreign | pkg::field::Explicit,
+      [&](const pkg::PackageRecord &record) {
+        packages.push_back(pkg::to_package(record));
+      },
+      &scratch);
+
+  char host[256] = {};
+  gethostname(host, sizeof(host) - 1);
+
+  if (!pkg::write_snapshot(opts.export_path, packages, host)) {
+    std::fprintf(stderr, "failed to write %s\n", opts.export_path.c_str());
+    return 1;
+  }
+  std::printf("wrote %zu packages to %s\n", packages.size(),
+              opts.export_path.c_str());
+  return 0;
+}
+
+int run_check_deps(const Options &opts) {
+  auto manager = make_manager(opts);
+
+  std::vector<pkg::Package> packages;
+  std::pmr::unsynchronized_pool_resource scratch;
+  manager->visitInstalled(
+      pkg::field::Name | pkg::field::Version | pkg::field::DependsOn |
+          pkg::field::Provides,
+      [&](const pkg::PackageRecord &record) {
+        packages.push_back(pkg::to_package(record));
+      },
+      &scratch);
+
+  pkg::DependencyIndex deps;
+  deps.build(packages);
+
+  auto broken = deps.broken();
+  for (const auto &b : broken) {
+    const auto &pkg = packages[b.package];
+    std::printf("%s: %s\n", pkg.name.c_str(),
+                dependency_label(packages, deps, b.package, b.dep).c_str());
+  }
+  return broken.empty() ? 0 : 1;
+}
+
+int run_since(const Options &opts) {
+  std::int64_t since = 0;
+  if (!pkg::parse_time_spec(opts.since, std::time(nullptr), since)) {
+    std::fprintf(stderr, "invalid time: %s\n", opts.since.c_str());
+    return 2;
+  }
+
+  pkg::History history;
+  if (opts.files.empty()) {
+    load_history(history, opts.jobs);
+  }
+  for (const auto &path : opts.files) {
+    if (!history.load(path, opts.jobs)) {
+      std::fprintf(stderr, "failed to read %s\n", path.c_str());
+      return 1;
+    }
+  }
+
+  for (const auto &ev : history.since(since)) {
+    std::printf("%s %.*s %.*s (%s) [%.*s]\n",
+                pkg::format_timestamp(ev.time).c_str(),
+                static_cast<int>(pkg::action_label(ev.action).size()),
+                pkg::action_label(ev.action).data(),
+                static_cast<int>(ev.package.size()), ev.package.data(),
+                version_change(ev).c_str(), static_cast<int>(ev.source.size()),
+                ev.source.data());
+  }
+  return 0;
+}
+
+std::thread start_verify(std::shared_ptr<pkg::PackageManager> manager,
+                         std::vector<pkg::Package> targets,
+                         std::shared_ptr<VerifyChannel> channel) {
+  return std::thread([manager, targets = std::move(targets), channel] {
+    pkg::verify_packages(*manager, targets, "/", 0, channel->progress,
+                         [&](const pkg::VerifyIssue &issue) {
+                           std::lock_guard<std::mutex> lock(channel->mutex);
+                           channel->issues.push_back(issue);
+                         });
+    std::lock_guard<std::mutex> lock(channel->mutex);
+    channel->done = true;
+  });
+}
+
+std::thread start_details_fetcher(std::shared_ptr<pkg::PackageManager> manager,
+                                  std::shared_ptr<DetailsChannel> channel) {
+  return std::thread([manager, channel] {
+    pkg::MemScope scope(pkg::MemTag::Backend);
+    std::unique_lock<std::mutex> lock(channel->mutex);
+    for (;;) {
+      channel->wake.wait(
+          lock, [&] { return channel->stop || !channel->queue.empty(); });
+      if (channel->stop) {
+        return;
+      }
+      auto job = std::move(channel->queue.front());
+      channel->queue.pop_front();
+      lock.unlock();
+      manager->fillDetails(job.second);
+      lock.lock();
+      channel->done.push_back(std::move(job));
+    }
+  });
+}
+
+void stop_details_fetcher(DetailsChannel &channel, std::thread &fetcher) {
+  {
+    std::lock_guard<std::mutex> lock(channel.mutex);
+    channel.stop = true;
+  }
+  channel.wake.notify_all();
+  if (fetcher.joinable()) {
+    fetcher.join();
+  }
+}
+
+void stop_verify(VerifyChannel *channel, std::thread &verifier) {
+  if (channel) {
+    channel->progress.cancel = true;
+  }
+  if (verifier.joinable()) {
+    verifier.join();
+  }
+}
+
+int run_verify(const Options &opts) {
+  auto manager = make_manager(opts);
+
+  std::vector<pkg::Package> targets;
+  std::pmr::unsynchronized_pool_resource scratch;
+  manager->visitInstalled(
+      pkg::field::Name | pkg::field::Version | pkg::field::Architecture,
+      [&](const pkg::PackageRecord &record) {
+        if (opts.files.empty() ||
+            std::find(opts.files.begin(), opts.files.end(), record.name) !=
+                opts.files.end()) {
+          targets.push_back(pkg::to_package(record));
+        }
+      },
+      &scratch);
+
+  pkg::VerifyProgress progress;
+  pkg::verify_packages(*manager, targets, opts.root, opts.jobs, progress,
+                       [](const pkg::VerifyIssue &issue) {
+                         std::printf("%s\n", describe_issue(issue).c_str());
+                       });
+
+  std::fprintf(stderr,
+               "%zu packages, %zu files, %.1f MiB hashed, %zu problems\n",
+               progress.packages_done.load(), progress.files_done.load(),
+               static_cast<double>(progress.bytes_hashed.load()) /
+                   (1024.0 * 1024.0),
+               progress.issues.load());
+  return progress.issues.load() == 0 ? 0 : 1;
+}
+
+int run_diff(const Options &opts) {
+  pkg::Snapshot from(opts.files[0]);
+  pkg::Snapshot to(opts.files[1]);
+  if (!from.ok() || !to.ok()) {
+    std::fprintf(stderr, "failed to read %s\n",
+                 (!from.ok() ? opts.files[0] : opts.files[1]).c_str());
+    return 1;
+  }
+
+  auto diff = pkg::diff_snapshots(from, to);
+  std::printf("--- %.*s\n+++ %.*s\n", static_cast<int>(from.host().size()),
+              from.host().data(), static_cast<int>(to.host().size()),
+              to.host().data());
+  for (const auto &d : diff) {
+    std::string name(d.name);
+    if (!d.architecture.empty()) {
+      name += ":" + std::string(d.architecture);
+    }
+    if (!d.source.empty()) {
+      name += " [" + std::string(d.source) + "]";
+    }
+    switch (d.kind) {
+    case pkg::SnapshotDiff::Kind::Added:
+      std::printf("+ %s %.*s\n", name.c_str(),
+                  static_cast<int>(d.new_version.size()),
+                  d.new_version.data());
+      break;
+    case pkg::SnapshotDiff::Kind::Removed:
+      std::printf("- %s %.*s\n", name.c_str(),
+                  static_cast<int>(d.old_version.size()),
+                  d.old_version.data());
+      break;
+    case pkg::SnapshotDiff::Kind::Changed:
+      std::printf("~ %s %.*s -> %.*s\n", name.c_str(),
+                  static_cast<int>(d.old_version.size()), d.old_version.data(),
+                  static_cast<int>(d.new_version.size()),
+                  d.new_version.data());
+      break;
+    }
+  }
+  return 0;
+}
+
+int run_histogram(const Options &opts) {
+  for (const auto &hist : pkg::aggregate_versions(opts.files, opts.jobs)) {
+    std::printf("%s:", hist.name.c_str());
+    for (const auto &[version, count] : hist.versions) {
+      std::printf(" %s x%u", version.c_str(), count);
+    }
+    std::printf("\n");
+  }
+  return 0;
+}
+
+int run_query(const Options &opts) {
+  pkg::Constraint constraint = pkg::parse_constraint(opts.query);
+  for (const auto &[host, version] :
+       pkg::hosts_matching(opts.files, constraint, opts.jobs)) {
+    std::printf("%s %s\n", host.c_str(), version.c_str());
+  }
+  return 0;
+}
+
+int run_tui(const Options &opts,
+            std::shared_ptr<pkg::PackageManager> manager, pkg::KeySource &keys,
+            LoadStats &stats) {
   cbreak();
   noecho();
   keypad(stdscr, TRUE);
@@ -414,24 +1389,70 @@ int main() {
   WINDOW *packages_win = create_window(height, left_w, 0, 0, "Packages");
   WINDOW *details_win = create_window(height, right_w, 0, left_w, "Details");
 
-  std::unique_ptr<pkg::PackageManager> manager;
-  if (has_pacman()) {
-    manager = std::make_unique<pkg::PacmanPackageManager>();
-  } else {
-    manager = std::make_unique<pkg::DummyPackageManager>();
-  }
+  auto channel = std::make_shared<LoadChannel>();
+  bool host_history = opts.synthetic.empty();
+  std::thread loader([manager, channel, host_history] {
+    pkg::MemScope scope(pkg::MemTag::Backend);
+    pkg::History history;
+    std::thread history_loader;
+    if (host_history) {
+      history_loader = std::thread([&history] {
+        pkg::MemScope scope(pkg::MemTag::History);
+        load_history(history);
+      });
+    }
 
-  std::vector<pkg::Package> packages = manager->listInstalled();
+    std::pmr::unsynchronized_pool_resource scratch;
+    manager->visitInstalled(
+        list_fields,
+        [&](const pkg::PackageRecord &record) {
+          pkg::MemScope scope(pkg::MemTag::Packages);
+          pkg::Package pkg = pkg::to_package(record);
+          std::lock_guard<std::mutex> lock(channel->mutex);
+          channel->pending.push_back(std::move(pkg));
+        },
+        &scratch);
+
+    if (history_loader.joinable()) {
+      history_loader.join();
+    }
+    std::lock_guard<std::mutex> lock(channel->mutex);
+    channel->history = std::move(history);
+    channel->done = true;
+  });
+  bool loading = true;
+
+  std::vector<pkg::Package> packages;
+  pkg::DependencyIndex deps;
+  pkg::DominatorTree dominators;
+  pkg::TextStore descriptions;
+  pkg::History history;
+  ChangeWindow changes;
+  changes.history = &history;
 
   std::string search_query;
   bool search_mode = false;
+  std::string since_input;
+  bool since_mode = false;
   bool show_help = false;
+  bool show_stats = false;
+  bool show_verify = false;
+  std::shared_ptr<VerifyChannel> verify;
+  std::thread verifier;
   FilterMode filter_mode = FilterMode::All;
   SortMode sort_mode = SortMode::NameAsc;
 
+  pkg::DependencyTree tree;
+  bool tree_focus = false;
+  auto details = std::make_shared<DetailsChannel>();
+  std::thread details_fetcher = start_details_fetcher(manager, details);
+  std::vector<char> details_requested;
+  std::size_t details_outstanding = 0;
+  std::uint64_t sorted_revision = 0;
+
   std::vector<int> visible_indices;
-  recompute_visible_indices(packages, search_query, filter_mode, sort_mode,
-                            visible_indices);
+  recompute_visible_indices(packages, deps, dominators, changes, search_query,
+                            filter_mode, sort_mode, visible_indices);
 
   int selected_visible_index = 0;
   int scroll_offset = 0;
@@ -446,36 +1467,206 @@ int main() {
   int current_global_index = -1;
   if (!visible_indices.empty()) {
     current_global_index = visible_indices[selected_visible_index];
-    manager->fillDetails(packages[current_global_index]);
+    fill_details(*manager, packages, descriptions, details_requested, deps,
+                 dominators, current_global_index);
   }
 
-  render_packages(packages_win, packages, visible_indices,
+  render_packages(packages_win, packages, dominators, visible_indices,
                   selected_visible_index, scroll_offset, search_query,
-                  search_mode, filter_mode, sort_mode);
-  render_details(details_win, packages, current_global_index);
+                  search_mode, since_input, since_mode, filter_mode, sort_mode,
+                  static_cast<int>(packages.size()));
+  render_details(details_win, packages, descriptions, deps, dominators, history,
+                 tree, tree_focus, current_global_index);
+  stats.first_frame_ms = ms_since(stats.start);
+
+  auto jump_to = [&](int target) {
+    if (!select_global_index(target, visible_indices, list_height,
+                             selected_visible_index, scroll_offset)) {
+      search_query.clear();
+      filter_mode = FilterMode::All;
+      recompute_visible_indices(packages, deps, dominators, changes,
+                                search_query, filter_mode, sort_mode,
+                                visible_indices);
+      select_global_index(target, visible_indices, list_height,
+                          selected_visible_index, scroll_offset);
+    }
+    current_global_index = target;
+    fill_details(*manager, packages, descriptions, details_requested, deps,
+                 dominators, current_global_index);
+  };
 
+  pkg::KeystrokeAllocations key_allocs;
   int ch;
-  while ((ch = getch()) != 'q') {
+  while ((ch = keys.next(
+              loading || show_verify || details_outstanding > 0 ? 50 : -1)) !=
+         'q') {
     bool need_rerender = false;
+    if (ch != ERR) {
+      key_allocs.begin();
+    }
+
+    if (loading) {
+      std::vector<pkg::Package> batch;
+      bool done = false;
+      {
+        std::lock_guard<std::mutex> lock(channel->mutex);
+        batch.swap(channel->pending);
+        done = channel->done;
+      }
+
+      if (!batch.empty()) {
+        if (stats.first_batch_ms < 0) {
+          stats.first_batch_ms = ms_since(stats.start);
+        }
+        stats.batches++;
+
+        int first_new = static_cast<int>(packages.size());
+        {
+          pkg::MemScope scope(pkg::MemTag::Packages);
+          packages.insert(packages.end(),
+                          std::make_move_iterator(batch.begin()),
+                          std::make_move_iterator(batch.end()));
+        }
+        merge_visible_indices(packages, deps, dominators, changes, first_new,
+                              search_query, filter_mode, sort_mode,
+                              visible_indices);
+
+        if (current_global_index >= 0) {
+          select_global_index(current_global_index, visible_indices,
+                              list_height, selected_visible_index,
+                              scroll_offset);
+        } else if (!visible_indices.empty()) {
+          selected_visible_index = 0;
+          scroll_offset = 0;
+          current_global_index = visible_indices[selected_visible_index];
+          fill_details(*manager, packages, descriptions, details_requested,
+                       deps, dominators, current_global_index);
+        }
+        need_rerender = true;
+      }
 
-    if (show_help) {
+      if (done) {
+        {
+          std::lock_guard<std::mutex> lock(channel->mutex);
+          history = std::move(channel->history);
+        }
+        {
+          pkg::MemScope scope(pkg::MemTag::Index);
+          deps.build(packages);
+          dominators.build(packages, deps);
+        }
+        {
+          pkg::MemScope scope(pkg::MemTag::Packages);
+          deps.link_required_by(packages);
+        }
+        {
+          pkg::MemScope scope(pkg::MemTag::Packages);
+          compact_descriptions(packages, descriptions);
+          descriptions.set_cache_blocks(description_cache_blocks(
+              list_height, descriptions.stats().blocks));
+        }
+        recompute_visible_indices(packages, deps, dominators, changes,
+                                  search_query, filter_mode, sort_mode,
+                                  visible_indices);
+        if (!select_global_index(current_global_index, visible_indices,
+                                 list_height, selected_visible_index,
+                                 scroll_offset)) {
+          selected_visible_index = 0;
+          scroll_offset = 0;
+          current_global_index =
+              visible_indices.empty() ? -1 : visible_indices.front();
+        }
+        tree.reset(current_global_index, packages, deps);
+        loading = false;
+        stats.load_done_ms = ms_since(stats.start);
+        stats.packages = packages.size();
+        loader.join();
+        need_rerender = true;
+      }
+    }
+
+    if (details_outstanding > 0) {
+      std::vector<std::pair<int, pkg::Package>> fetched;
+      {
+        std::lock_guard<std::mutex> lock(details->mutex);
+        fetched.swap(details->done);
+      }
+      for (auto &[index, pkg] : fetched) {
+        IndexedFields before = indexed_fields(packages[index]);
+        apply_details(packages[index], std::move(pkg));
+        store_description(descriptions, packages[index], index);
+        update_indexes(before, packages, deps, dominators, index);
+      }
+      details_outstanding -= fetched.size();
+      need_rerender = need_rerender || !fetched.empty();
+    }
+
+    if (show_verify) {
+      if (ch == 'v' || ch == 27) {
+        stop_verify(verify.get(), verifier);
+        show_verify = false;
+      }
+      need_rerender = true;
+    } else if (show_stats) {
+      if (ch == 's') {
+        show_stats = false;
+        need_rerender = true;
+      }
+    } else if (show_help) {
       if (ch == 'h' || ch == '?') {
         show_help = false;
         need_rerender = true;
       } else if (ch == 'q') {
         break;
       }
+    } else if (since_mode) {
+      if (ch == 27) {
+        since_mode = false;
+        need_rerender = true;
+      } else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
+        if (!since_input.empty()) {
+          since_input.pop_back();
+        }
+        need_rerender = true;
+      } else if (ch == '\n' || ch == KEY_ENTER) {
+        std::int64_t since = 0;
+        if (pkg::parse_time_spec(since_input, std::time(nullptr), since)) {
+          since_mode = false;
+          changes.since = since;
+          filter_mode = FilterMode::ChangedSince;
+          recompute_visible_indices(packages, deps, dominators, changes,
+                                    search_query, filter_mode, sort_mode,
+                                    visible_indices);
+          selected_visible_index = 0;
+          scroll_offset = 0;
+          if (!visible_indices.empty()) {
+            current_global_index = visible_indices[selected_visible_index];
+            fill_details(*manager, packages, descriptions, details_requested,
+                         deps, dominators, current_global_index);
+          } else {
+            current_global_index = -1;
+          }
+        } else {
+          beep();
+        }
+        need_rerender = true;
+      } else if (ch >= 32 && ch <= 126) {
+        since_input.push_back(static_cast<char>(ch));
+        need_rerender = true;
+      }
     } else if (search_mode) {
       if (ch == 27) {
         search_mode = false;
         search_query.clear();
-        recompute_visible_indices(packages, search_query, filter_mode,
-                                  sort_mode, visible_indices);
+        recompute_visible_indices(packages, deps, dominators, changes,
+                                  search_query, filter_mode, sort_mode,
+                                  visible_indices);
         selected_visible_index = 0;
         scroll_offset = 0;
         if (!visible_indices.empty()) {
           current_global_index = visible_indices[selected_visible_index];
-          manager->fillDetails(packages[current_global_index]);
+          fill_details(*manager, packages, descriptions, details_requested,
+                       deps, dominators, current_global_index);
         } else {
           current_global_index = -1;
         }
@@ -483,13 +1674,15 @@ int main() {
       } else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
         if (!search_query.empty()) {
           search_query.pop_back();
-          recompute_visible_indices(packages, search_query, filter_mode,
-                                    sort_mode, visible_indices);
+          recompute_visible_indices(packages, deps, dominators, changes,
+                                    search_query, filter_mode, sort_mode,
+                                    visible_indices);
           selected_visible_index = 0;
           scroll_offset = 0;
           if (!visible_indices.empty()) {
             current_global_index = visible_indices[selected_visible_index];
-            manager->fillDetails(packages[current_global_index]);
+            fill_details(*manager, packages, descriptions, details_requested,
+                         deps, dominators, current_global_index);
           } else {
             current_global_index = -1;
           }
@@ -517,45 +1710,114 @@ int main() {
           }
 
           current_global_index = visible_indices[selected_visible_index];
-          manager->fillDetails(packages[current_global_index]);
+          fill_details(*manager, packages, descriptions, details_requested,
+                       deps, dominators, current_global_index);
         }
         need_rerender = true;
       } else if (ch >= 32 && ch <= 126) {
         search_query.push_back(static_cast<char>(ch));
-        recompute_visible_indices(packages, search_query, filter_mode,
-                                  sort_mode, visible_indices);
+        recompute_visible_indices(packages, deps, dominators, changes,
+                                  search_query, filter_mode, sort_mode,
+                                  visible_indices);
         selected_visible_index = 0;
         scroll_offset = 0;
         if (!visible_indices.empty()) {
           current_global_index = visible_indices[selected_visible_index];
-          manager->fillDetails(packages[current_global_index]);
+          fill_details(*manager, packages, descriptions, details_requested,
+                       deps, dominators, current_global_index);
         } else {
           current_global_index = -1;
         }
         need_rerender = true;
       }
+    } else if (tree_focus) {
+      if (ch == 27 || ch == '\t' || ch == 't') {
+        tree_focus = false;
+      } else if (ch == KEY_UP || ch == KEY_DOWN) {
+        tree.move(ch == KEY_UP ? -1 : 1);
+      } else if (ch == KEY_PPAGE || ch == KEY_NPAGE) {
+        tree.move(ch == KEY_PPAGE ? -10 : 10);
+      } else if (ch == KEY_RIGHT || ch == '+' || ch == ' ') {
+        std::vector<int> revealed;
+        tree.expand(packages, deps, revealed);
+        details_requested.resize(packages.size(), 0);
+        std::lock_guard<std::mutex> lock(details->mutex);
+        for (int index : revealed) {
+          if (!details_requested[index]) {
+            details_requested[index] = 1;
+            details->queue.emplace_back(index,
+                                        details_request(packages[index]));
+            ++details_outstanding;
+          }
+        }
+        details->wake.notify_one();
+      } else if (ch == KEY_LEFT || ch == '-') {
+        tree.collapse();
+      } else if ((ch == '\n' || ch == KEY_ENTER) && !tree.rows().empty()) {
+        const auto &row = tree.rows()[tree.cursor()];
+        if (!row.header && row.package >= 0) {
+          jump_to(row.package);
+        }
+      }
+      need_rerender = true;
     } else {
       if (ch == '/') {
         search_mode = true;
         need_rerender = true;
+      } else if (ch == 't' || ch == '\t') {
+        tree_focus = current_global_index >= 0 && !loading;
+        need_rerender = true;
+      } else if (ch == 'c') {
+        since_mode = true;
+        need_rerender = true;
       } else if (ch == 'h' || ch == '?') {
         show_help = true;
         need_rerender = true;
+      } else if (ch == 's') {
+        show_stats = true;
+        need_rerender = true;
+      } else if ((ch == 'v' && current_global_index >= 0) || ch == 'V') {
+        std::vector<pkg::Package> targets;
+        if (ch == 'v') {
+          targets.push_back(packages[current_global_index]);
+        } else {
+          targets = packages;
+        }
+        verify = std::make_shared<VerifyChannel>();
+        verifier = start_verify(manager, std::move(targets), verify);
+        show_verify = true;
+        need_rerender = true;
+      } else if (ch >= '1' && ch <= '9') {
+        std::size_t n = static_cast<std::size_t>(ch - '1');
+        int target = -1;
+        if (current_global_index >= 0 &&
+            current_global_index < static_cast<int>(deps.size()) &&
+            n < deps.depends(current_global_index).size()) {
+          target = deps.depends(current_global_index)[n].target;
+        }
+        if (target >= 0) {
+          jump_to(target);
+          need_rerender = true;
+        }
       } else if (ch == 'f') {
         if (filter_mode == FilterMode::All) {
           filter_mode = FilterMode::ExplicitOnly;
         } else if (filter_mode == FilterMode::ExplicitOnly) {
           filter_mode = FilterMode::AurOnly;
+        } else if (filter_mode == FilterMode::AurOnly) {
+          filter_mode = FilterMode::BrokenDeps;
         } else {
           filter_mode = FilterMode::All;
         }
-        recompute_visible_indices(packages, search_query, filter_mode,
-                                  sort_mode, visible_indices);
+        recompute_visible_indices(packages, deps, dominators, changes,
+                                  search_query, filter_mode, sort_mode,
+                                  visible_indices);
         selected_visible_index = 0;
         scroll_offset = 0;
         if (!visible_indices.empty()) {
           current_global_index = visible_indices[selected_visible_index];
-          manager->fillDetails(packages[current_global_index]);
+          fill_details(*manager, packages, descriptions, details_requested,
+                       deps, dominators, current_global_index);
         } else {
           current_global_index = -1;
         }
@@ -567,16 +1829,20 @@ int main() {
           sort_mode = SortMode::ExplicitFirst;
         } else if (sort_mode == SortMode::ExplicitFirst) {
           sort_mode = SortMode::AurFirst;
+        } else if (sort_mode == SortMode::AurFirst) {
+          sort_mode = SortMode::Footprint;
         } else {
           sort_mode = SortMode::NameAsc;
         }
-        recompute_visible_indices(packages, search_query, filter_mode,
-                                  sort_mode, visible_indices);
+        recompute_visible_indices(packages, deps, dominators, changes,
+                                  search_query, filter_mode, sort_mode,
+                                  visible_indices);
         selected_visible_index = 0;
         scroll_offset = 0;
         if (!visible_indices.empty()) {
           current_global_index = visible_indices[selected_visible_index];
-          manager->fillDetails(packages[current_global_index]);
+          fill_details(*manager, packages, descriptions, details_requested,
+                       deps, dominators, current_global_index);
         } else {
           current_global_index = -1;
         }
@@ -598,29 +1864,362 @@ int main() {
           }
 
           current_global_index = visible_indices[selected_visible_index];
-          manager->fillDetails(packages[current_global_index]);
+          fill_details(*manager, packages, descriptions, details_requested,
+                       deps, dominators, current_global_index);
         }
         need_rerender = true;
       }
     }
 
+    if (dominators.revision() != sorted_revision) {
+      sorted_revision = dominators.revision();
+      if (sort_mode == SortMode::Footprint && !loading) {
+        recompute_visible_indices(packages, deps, dominators, changes,
+                                  search_query, filter_mode, sort_mode,
+                                  visible_indices);
+        select_global_index(current_global_index, visible_indices,
+                            list_height, selected_visible_index,
+                            scroll_offset);
+        need_rerender = true;
+      }
+    }
+
     if (need_rerender) {
       getmaxyx(stdscr, max_y, max_x);
       clear();
       refresh();
       if (show_help) {
         render_help_overlay(max_y, max_x);
+      } else if (show_stats) {
+        stats.descriptions = descriptions.stats();
+        render_stats_overlay(max_y, max_x, stats, packages.size(),
+                             key_allocs);
+      } else if (show_verify) {
+        render_verify_overlay(max_y, max_x, *verify);
       } else {
-        render_packages(packages_win, packages, visible_indices,
+        render_packages(packages_win, packages, dominators, visible_indices,
                         selected_visible_index, scroll_offset, search_query,
-                        search_mode, filter_mode, sort_mode);
-        render_details(details_win, packages, current_global_index);
+                        search_mode, since_input, since_mode, filter_mode,
+                        sort_mode,
+                        loading ? static_cast<int>(packages.size()) : -1);
+        if (tree.root() != current_global_index) {
+          tree.reset(current_global_index, packages, deps);
+        }
+        render_details(details_win, packages, descriptions, deps, dominators,
+                       history, tree, tree_focus, current_global_index);
       }
     }
+    key_allocs.end();
   }
 
+  stop_verify(verify.get(), verifier);
+  stop_details_fetcher(*details, details_fetcher);
+
   delwin(packages_win);
   delwin(details_win);
   endwin();
+
+  if (loading) {
+    loader.detach();
+  }
+
+  if (opts.print_timings) {
+    std::fprintf(stderr, "time-to-first-frame: %.1f ms\n",
+                 stats.first_frame_ms);
+    std::fprintf(stderr, "first-batch: %.1f ms\n", stats.first_batch_ms);
+    std::fprintf(stderr, "load-complete: %.1f ms\n", stats.load_done_ms);
+    std::fprintf(stderr, "packages: %zu in %d batches\n", packages.size(),
+                 stats.batches);
+  }
+  if (opts.mem_stats) {
+    pkg::write_mem_json(stderr, pkg::mem_report(), key_allocs);
+  }
   return 0;
 }
+
+int run_replay(const Options &opts) {
+  std::vector<int> keys;
+  if (!pkg::load_script(opts.replay, keys)) {
+    std::fprintf(stderr, "cannot load script %s (built in:",
+                 opts.replay.c_str());
+    for (auto name : pkg::builtin_scripts()) {
+      std::fprintf(stderr, " %.*s", static_cast<int>(name.size()),
+                   name.data());
+    }
+    std::fprintf(stderr, ")\n");
+    return 2;
+  }
+
+  setenv("LINES", "48", 0);
+  setenv("COLUMNS", "160", 0);
+
+  std::vector<int> counts = opts.synthetic;
+  if (counts.empty()) {
+    counts.push_back(0);
+  }
+
+  int status = 0;
+  std::printf("%10s %6s %9s %9s %9s %12s %10s %11s\n", "packages", "keys",
+              "p50 ms", "p99 ms", "max ms", "bytes", "bytes/key",
+              "allocs/key");
+  for (int count : counts) {
+    Options run = opts;
+    run.synthetic.clear();
+    if (count > 0) {
+      run.synthetic.push_back(count);
+    }
+    std::shared_ptr<pkg::PackageManager> manager = make_manager(run);
+
+    pkg::ScreenSink sink;
+    std::FILE *screen_in = std::fopen("/dev/null", "r");
+    SCREEN *screen = sink.ok() && screen_in
+                         ? newterm("xterm-256color", sink.stream(), screen_in)
+                         : nullptr;
+    if (!screen) {
+      std::fprintf(stderr, "cannot create off-screen terminal\n");
+      return 1;
+    }
+    set_term(screen);
+
+    pkg::ScriptKeys script(keys, sink);
+    LoadStats stats;
+    stats.start = Clock::now();
+    run_tui(run, manager, script, stats);
+
+    delscreen(screen);
+    std::fclose(screen_in);
+
+    pkg::ReplayReport report = script.report();
+    double keys_run = report.keys ? static_cast<double>(report.keys) : 1.0;
+    std::printf("%10zu %6zu %9.2f %9.2f %9.2f %12llu %10.0f ", stats.packages,
+                report.keys, report.p50_ms, report.p99_ms, report.max_ms,
+                static_cast<unsigned long long>(report.bytes),
+                static_cast<double>(report.bytes) / keys_run);
+    if (opts.mem_stats) {
+      std::printf("%11.1f\n",
+                  static_cast<double>(report.allocations) / keys_run);
+    } else {
+      std::printf("%11s\n", "-");
+    }
+    if (report.stalled) {
+      std::fprintf(stderr,
+                   "%zu packages: gave up waiting for the tui to go idle\n",
+                   stats.packages);
+      status = 1;
+    }
+  }
+  return status;
+}
+
+std::uint64_t string_heap_bytes(const std::string &s) {
+  static const std::size_t inline_capacity = std::string().capacity();
+  if (s.capacity() <= inline_capacity) {
+    return 0;
+  }
+  return std::max<std::uint64_t>(32, (s.capacity() + 1 + 8 + 15) & ~15ull);
+}
+
+bool contains_ignore_case(std::string_view text, std::string_view needle) {
+  auto it = std::search(text.begin(), text.end(), needle.begin(), needle.end(),
+                        [](char a, char b) {
+                          return std::tolower(static_cast<unsigned char>(a)) ==
+                                 std::tolower(static_cast<unsigned char>(b));
+                        });
+  return it != text.end() || needle.empty();
+}
+
+template <typename Fetch>
+double lookup_ns(const std::vector<std::size_t> &ids, Fetch &&fetch) {
+  if (ids.empty()) {
+    return 0.0;
+  }
+  std::string out;
+  volatile std::size_t bytes = 0;
+  auto start = Clock::now();
+  for (std::size_t id : ids) {
+    fetch(id, out);
+    bytes = bytes + out.size();
+  }
+  return ms_since(start) * 1e6 / static_cast<double>(ids.size());
+}
+
+int run_store_report(const Options &opts) {
+  auto manager = make_manager(opts);
+  std::vector<std::string> plain;
+  std::pmr::unsynchronized_pool_resource scratch;
+  manager->visitInstalled(
+      pkg::field::Name | pkg::field::Description,
+      [&](const pkg::PackageRecord &record) {
+        plain.emplace_back(record.description);
+      },
+      &scratch);
+
+  constexpr std::size_t screen_rows = 40;
+  std::vector<std::string_view> texts(plain.begin(), plain.end());
+  pkg::TextStore store;
+  auto build_start = Clock::now();
+  if (!store.build(texts)) {
+    std::fprintf(stderr, "failed to build description store\n");
+    return 1;
+  }
+  store.set_cache_blocks(
+      description_cache_blocks(screen_rows, store.stats().blocks));
+  double build_ms = ms_since(build_start);
+
+  std::uint64_t plain_bytes = 0;
+  std::size_t empty = 0;
+  for (const auto &text : plain) {
+    plain_bytes += string_heap_bytes(text);
+    empty += text.empty() ? 1 : 0;
+  }
+
+  std::vector<std::size_t> visible;
+  for (std::size_t top = 0; top < plain.size(); ++top) {
+    for (std::size_t row = top; row < plain.size() && row < top + screen_rows;
+         ++row) {
+      visible.push_back(row);
+    }
+  }
+  std::vector<std::size_t> random;
+  std::mt19937 rng(42);
+  if (!plain.empty()) {
+    std::uniform_int_distribution<std::size_t> pick(0, plain.size() - 1);
+    for (std::size_t i = 0; i < 100000; ++i) {
+      random.push_back(pick(rng));
+    }
+  }
+
+  auto from_plain = [&](std::size_t id, std::string &out) {
+    out.assign(plain[id]);
+  };
+  auto from_store = [&](std::size_t id, std::string &out) {
+    store.get(id, out);
+  };
+  auto hit_rate = [](const pkg::TextStoreStats &before,
+                     const pkg::TextStoreStats &after) {
+    std::uint64_t hits = after.cache_hits - before.cache_hits;
+    std::uint64_t total = hits + after.cache_misses - before.cache_misses;
+    return total ? 100.0 * static_cast<double>(hits) / total : 0.0;
+  };
+
+  double visible_plain = lookup_ns(visible, from_plain);
+  pkg::TextStoreStats before = store.stats();
+  double visible_store = lookup_ns(visible, from_store);
+  pkg::TextStoreStats after_visible = store.stats();
+  double random_plain = lookup_ns(random, from_plain);
+  double random_store = lookup_ns(random, from_store);
+  pkg::TextStoreStats after_random = store.stats();
+
+  std::printf("descriptions: %zu (%zu empty), %s raw\n", plain.size(), empty,
+              format_size(after_random.raw_bytes).c_str());
+  std::printf("std::string heap: %s\n", format_size(plain_bytes).c_str());
+  std::printf("text store: %s (data %s, dictionary %s, index %s, cache %s)\n",
+              format_size(after_random.footprint()).c_str(),
+              format_size(after_random.compressed_bytes).c_str(),
+              format_size(after_random.dictionary_bytes).c_str(),
+              format_size(after_random.index_bytes).c_str(),
+              format_size(after_random.cache_bytes).c_str());
+  if (plain_bytes > after_random.footprint()) {
+    std::uint64_t saved = plain_bytes - after_random.footprint();
+    std::printf("saved: %s (%.1f%%)\n", format_size(saved).c_str(),
+                100.0 * static_cast<double>(saved) / plain_bytes);
+  } else {
+    std::printf("saved: none\n");
+  }
+  std::printf("build: %.1f ms, %zu blocks\n\n", build_ms,
+              after_random.blocks);
+
+  std::printf("%-22s %12s %12s %10s\n", "lookup", "std::string", "store",
+              "cache hit");
+  std::printf("%-22s %9.0f ns %9.0f ns %9.1f%%\n", "visible rows",
+              visible_plain, visible_store, hit_rate(before, after_visible));
+  std::printf("%-22s %9.0f ns %9.0f ns %9.1f%%\n\n", "random",
+              random_plain, random_store,
+              hit_rate(after_visible, after_random));
+
+  std::vector<std::string> needles = {"library", "python", "daemon", "zzzz"};
+  if (!plain.empty()) {
+    const std::string &sample = plain[plain.size() / 2];
+    std::size_t space = sample.rfind(' ');
+    needles.push_back(
+        sample.substr(space == std::string::npos ? 0 : space + 1));
+  }
+  std::printf("%-22s %12s %12s %10s %8s\n", "search", "std::string",
+              "store", "blocks", "matches");
+  for (const auto &needle : needles) {
+    auto start = Clock::now();
+    std::size_t plain_matches = 0;
+    for (const auto &text : plain) {
+      plain_matches += contains_ignore_case(text, needle) ? 1 : 0;
+    }
+    double plain_us = ms_since(start) * 1000.0;
+
+    std::vector<std::size_t> matches;
+    start = Clock::now();
+    std::size_t scanned = store.search(needle, matches);
+    double store_us = ms_since(start) * 1000.0;
+
+    std::string label = "\"" + needle + "\"";
+    std::printf("%-22.22s %9.0f us %9.0f us %4zu/%-5zu %8zu\n", label.c_str(),
+                plain_us, store_us, scanned, after_random.blocks,
+                matches.size());
+    if (matches.size() != plain_matches) {
+      std::fprintf(stderr, "search mismatch for %s: %zu vs %zu\n",
+                   needle.c_str(), matches.size(), plain_matches);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  LoadStats stats;
+  stats.start = Clock::now();
+
+  Options opts;
+  if (!parse_options(argc, argv, opts)) {
+    print_usage(argv[0]);
+    return 2;
+  }
+  if (opts.mem_stats) {
+    pkg::mem_stats_enable();
+  }
+
+  if (opts.attach && !pkg::RemotePackageManager(opts.socket_path).connect()) {
+    std::fprintf(stderr, "cannot attach to %s\n", opts.socket_path.c_str());
+    return 1;
+  }
+
+  switch (opts.mode) {
+  case Mode::Daemon:
+    return run_daemon(opts);
+  case Mode::Bench:
+    return run_bench(opts);
+  case Mode::Replay:
+    return run_replay(opts);
+  case Mode::StoreReport:
+    return run_store_report(opts);
+  case Mode::CheckDeps:
+    return run_check_deps(opts);
+  case Mode::Since:
+    return run_since(opts);
+  case Mode::Verify:
+    return run_verify(opts);
+  case Mode::Export:
+    return run_export(opts);
+  case Mode::Diff:
+    return run_diff(opts);
+  case Mode::Histogram:
+    return run_histogram(opts);
+  case Mode::Query:
+    return run_query(opts);
+  case Mode::Tui:
+    break;
+  }
+
+  initscr();
+  pkg::TerminalKeys keys;
+  return run_tui(opts, make_manager(opts), keys, stats);
+}
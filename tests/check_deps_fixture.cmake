@@ -0,0 +1,23 @@
+execute_process(
+  COMMAND ${EXPLORER} --check-deps --dbpath ${FIXTURE}
+  OUTPUT_VARIABLE out
+  ERROR_VARIABLE err
+  RESULT_VARIABLE rc)
+
+if(NOT rc EQUAL 1)
+  message(FATAL_ERROR "expected exit status 1, got ${rc}\n${out}${err}")
+endif()
+
+foreach(expected
+        "missing-user: libgone0 | libalsogone2 (missing)"
+        "missing-user: removed-pkg (missing)"
+        "unmet-user: base-files (>= 13) (unmet: 12.4)")
+  string(FIND "${out}" "${expected}" at)
+  if(at EQUAL -1)
+    message(FATAL_ERROR "missing report: ${expected}\n${out}")
+  endif()
+endforeach()
+
+if(out MATCHES "alternatives-user|qualified-user|virtual-user")
+  message(FATAL_ERROR "unexpected report\n${out}")
+endif()
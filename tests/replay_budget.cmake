@@ -0,0 +1,25 @@
+execute_process(
+  COMMAND ${EXPLORER} --replay ${SCRIPT} --synthetic ${SYNTHETIC} --mem-stats
+  OUTPUT_VARIABLE out
+  ERROR_VARIABLE err
+  RESULT_VARIABLE rc)
+
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "replay exited with ${rc}\n${out}${err}")
+endif()
+
+string(REGEX MATCHALL "[^\n]+" lines "${out}")
+set(rows 0)
+foreach(line ${lines})
+  if(line MATCHES "^ *([0-9]+) .* ([0-9]+\\.[0-9])$")
+    math(EXPR rows "${rows} + 1")
+    if(CMAKE_MATCH_2 GREATER BUDGET)
+      message(FATAL_ERROR "${CMAKE_MATCH_1} packages: ${CMAKE_MATCH_2} "
+                          "allocations per key exceeds ${BUDGET}\n${out}")
+    endif()
+  endif()
+endforeach()
+
+if(rows EQUAL 0)
+  message(FATAL_ERROR "no allocation figures in replay output\n${out}")
+endif()
@@ -0,0 +1,52 @@
+file(REMOVE_RECURSE ${WORKDIR})
+file(MAKE_DIRECTORY ${WORKDIR})
+
+function(explorer out_var)
+  execute_process(
+    COMMAND ${EXPLORER} ${ARGN}
+    OUTPUT_VARIABLE out
+    ERROR_VARIABLE err
+    RESULT_VARIABLE rc)
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${ARGN} exited with ${rc}\n${out}${err}")
+  endif()
+  set(${out_var} "${out}" PARENT_SCOPE)
+endfunction()
+
+function(expect_lines text)
+  foreach(expected ${ARGN})
+    string(FIND "${text}" "${expected}\n" at)
+    if(at EQUAL -1)
+      message(FATAL_ERROR "missing line: ${expected}\n${text}")
+    endif()
+  endforeach()
+endfunction()
+
+foreach(side before after)
+  explorer(out --export ${WORKDIR}/${side}.snap
+           --dbpath ${FIXTURE}/${side})
+  expect_lines("${out}" "wrote 5 packages to ${WORKDIR}/${side}.snap")
+endforeach()
+
+explorer(diff --diff ${WORKDIR}/before.snap ${WORKDIR}/after.snap)
+expect_lines("${diff}"
+             "~ curl:amd64 7.88.1-10 -> 8.5.0-1"
+             "~ libc6:amd64 2.36-9 -> 2.36-9+deb12u4"
+             "+ newpkg:all 0.3-1"
+             "- oldpkg:all 1.0-1")
+if(diff MATCHES "i386|zlib1g")
+  message(FATAL_ERROR "unexpected diff line\n${diff}")
+endif()
+
+explorer(histogram --histogram --jobs 2 ${WORKDIR}/before.snap
+         ${WORKDIR}/after.snap)
+expect_lines("${histogram}"
+             "curl: 7.88.1-10 x1 8.5.0-1 x1"
+             "libc6: 2.36-9 x3 2.36-9+deb12u4 x1"
+             "zlib1g: 1:1.2.13.dfsg-1 x2")
+
+explorer(query --query "libc6>=2.36-9+deb12u4" ${WORKDIR}/before.snap
+         ${WORKDIR}/after.snap)
+if(NOT query MATCHES "^[^\n]* 2\\.36-9\\+deb12u4\n$")
+  message(FATAL_ERROR "unexpected query result\n${query}")
+endif()
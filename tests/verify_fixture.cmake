@@ -0,0 +1,41 @@
+set(mtree ${WORKDIR}/db/local/fixture-1.0-1/mtree)
+file(REMOVE_RECURSE ${WORKDIR})
+file(COPY ${FIXTURE}/db DESTINATION ${WORKDIR})
+file(ARCHIVE_CREATE OUTPUT ${mtree}.gz PATHS ${mtree} FORMAT raw
+     COMPRESSION GZip)
+file(RENAME ${mtree}.gz ${mtree})
+
+file(READ ${mtree} magic LIMIT 2 HEX)
+if(NOT magic STREQUAL "1f8b")
+  message(FATAL_ERROR "failed to gzip ${mtree}")
+endif()
+
+foreach(db ${FIXTURE}/db ${WORKDIR}/db)
+  execute_process(
+    COMMAND ${EXPLORER} --verify --root ${FIXTURE} --dbpath ${db} --jobs 2
+    OUTPUT_VARIABLE out
+    ERROR_VARIABLE err
+    RESULT_VARIABLE rc)
+
+  if(NOT rc EQUAL 1)
+    message(FATAL_ERROR
+            "${db}: expected exit status 1, got ${rc}\n${out}${err}")
+  endif()
+
+  foreach(expected
+          "fixture: /usr/share/fixture/tampered.txt: checksum mismatch"
+          "fixture: /usr/share/fixture/missing.txt: missing"
+          "fixture: /usr/bin/fixture-tool: mode mismatch (755 != ")
+    string(FIND "${out}" "${expected}" at)
+    if(at EQUAL -1)
+      message(FATAL_ERROR "${db}: missing report: ${expected}\n${out}")
+    endif()
+  endforeach()
+
+  if(out MATCHES "intact\\.txt|size mismatch")
+    message(FATAL_ERROR "${db}: unexpected report\n${out}")
+  endif()
+  if(NOT err MATCHES "1 packages, 8 files, .* 3 problems")
+    message(FATAL_ERROR "${db}: unexpected summary: ${err}")
+  endif()
+endforeach()